@@ -21,7 +21,7 @@ void CodeGenVisitor::visit(ASTBlockNode& node)
     // Adds function definition to symbol table
     for (auto& statement : node.statements)
     {
-        ASTFunctionNode* funcNode = dynamic_cast<ASTFunctionNode*>(statement.get());
+        ASTFunctionNode* funcNode = statement->As<ASTFunctionNode>();
         if (funcNode)
         {
             symbolTable.AddEntry(funcNode->name, Entry(funcNode->returnSize));
@@ -30,6 +30,11 @@ void CodeGenVisitor::visit(ASTBlockNode& node)
 
     for (auto& statement : node.statements)
     {
+        // Functions a lazy parse skipped and no call reached are left out
+        ASTFunctionNode* funcNode = statement->As<ASTFunctionNode>();
+        if (funcNode && !funcNode->IsParsed())
+            continue;
+
         statement->accept(*this);
     }
 
@@ -169,21 +174,22 @@ void CodeGenVisitor::visit(ASTCastNode& node)
 void CodeGenVisitor::visit(ASTAssignmentNode& node)
 {
     node.expr->accept(*this);
-    auto& entry = symbolTable[node.identifier->name];
-    auto arrIndexNode = dynamic_cast<ASTArrayIndexNode*>(node.identifier.get());
+    // Copied, as visiting the index in StoreVar can move the entries of the symbol table
+    auto entry = symbolTable[node.identifier->name];
+    auto arrIndexNode = node.identifier->As<ASTArrayIndexNode>();
     if (!entry.IsArray() || arrIndexNode)
     {
-        Scope<ASTExpressionNode> index = nullptr;
+        ASTExpressionNode* index = nullptr;
         if (arrIndexNode)
         {
-            index = std::move(arrIndexNode->index);
+            index = arrIndexNode->index;
         }
-        StoreVar(node.identifier->name, std::move(index));
+        StoreVar(node.identifier->name, index);
     }
     else
     {
         // Assigning to a variable, so the data has to be reversed
-        if (auto idNode = dynamic_cast<ASTIdentifierNode*>(node.expr.get()))
+        if (auto idNode = node.expr->As<ASTIdentifierNode>())
         {
             auto& assignedEntry = symbolTable[idNode->name];
 
@@ -263,7 +269,7 @@ void CodeGenVisitor::visit(ASTFunctionNode& node)
 {
     AddFuncInstructionList(node);
 
-    AddInstruction<FuncDeclInstruction>(node.name);
+    AddInstruction<FuncDeclInstruction>(StringInterner::Global()[node.name]);
 
     symbolTable.PushScope(true);
 
@@ -287,7 +293,7 @@ void CodeGenVisitor::visit(ASTFunctionNode& node)
         index += (param.IsArray() ? param.ArraySize : 1);
     }
 
-    node.blockNode->accept(*this);
+    node.Body()->accept(*this);
 
     symbolTable.PopScope();
 
@@ -340,14 +346,14 @@ void CodeGenVisitor::visit(ASTPrintNode& node)
     node.expr->accept(*this);
     int arraySize = -1;
     bool reverse = false;
-    auto idNode = dynamic_cast<ASTIdentifierNode*>(node.expr.get());
-    if (idNode && !dynamic_cast<ASTArrayIndexNode*>(node.expr.get()))
+    auto idNode = node.expr->As<ASTIdentifierNode>();
+    if (idNode && node.expr->kind != NodeKind::ARRAY_INDEX)
     {
         arraySize = symbolTable[idNode->name].arraySize;
         reverse = true;
     }
 
-    auto funcNode = dynamic_cast<ASTFuncCallNode*>(node.expr.get());
+    auto funcNode = node.expr->As<ASTFuncCallNode>();
     if (funcNode)
     {
         arraySize = symbolTable[funcNode->funcName].arraySize;
@@ -422,7 +428,7 @@ void CodeGenVisitor::visit(ASTFuncCallNode& node)
     for (auto it = node.args.rbegin(); it != node.args.rend(); ++it)
     {
         (*it)->accept(*this);
-        if (auto idNode = dynamic_cast<ASTIdentifierNode*>((*it).get()))
+        if (auto idNode = (*it)->As<ASTIdentifierNode>())
         {
             auto& entry = symbolTable[idNode->name];
             if (entry.IsArray())
@@ -443,7 +449,7 @@ void CodeGenVisitor::visit(ASTFuncCallNode& node)
     }
 
     AddInstruction<PushInstruction>(argSize);
-    AddInstruction<PushFuncInstruction>(node.funcName);
+    AddInstruction<PushFuncInstruction>(StringInterner::Global()[node.funcName]);
     AddInstruction<CallInstruction>();
 }
 
@@ -505,7 +511,8 @@ void CodeGenVisitor::visit(ASTArraySetNode& node)
 
 void CodeGenVisitor::visit(ASTArrayIndexNode& node)
 {
-    auto& entry = symbolTable[node.name];
+    // Copied, as visiting the index can move the entries of the symbol table
+    auto entry = symbolTable[node.name];
     node.index->accept(*this);
     AddInstruction<PushArrayIndexInstruction>(entry.index, VM_FRAME_INDEX(entry.frameIndex));
 }
@@ -4,7 +4,7 @@
 #include "../Utils/SymbolTable.h"
 #include "Instructions.h"
 
-class CodeGenVisitor : public Visitor
+class CodeGenVisitor final : public Visitor
 {
 public:
     struct Entry
@@ -80,6 +80,8 @@ public:
     virtual void visit(ASTRandIntNode& node) override;
     virtual void visit(ASTFuncCallNode& node) override;
     virtual void visit(ASTClearNode& node) override;
+    virtual void visit(ASTArraySetNode& node) override;
+    virtual void visit(ASTArrayIndexNode& node) override;
 
     std::string Finalize();
 
@@ -113,9 +115,10 @@ public:
         symbolTable.PopScope();
     }
 
-    void StoreVar(const std::string& name, Scope<ASTExpressionNode> index = nullptr)
+    void StoreVar(SymbolID name, ASTExpressionNode* index = nullptr)
     {
-        auto& entry = symbolTable[name];
+        // Copied, as visiting the index can move the entries of the symbol table
+        auto entry = symbolTable[name];
         if (entry.IsArray())
         {
             index->accept(*this);
@@ -162,13 +165,5 @@ private:
 
     int returnArraySize = 0;
 
-
-    // Inherited via Visitor
-    void visit(ASTArraySetNode& node) override;
-
-
-    // Inherited via Visitor
-    void visit(ASTArrayIndexNode& node) override;
-
 };
 
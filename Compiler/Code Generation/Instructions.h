@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <string_view>
 #include <format>
 #include <cassert>
 
@@ -122,7 +123,7 @@ public:
 class PushFuncInstruction : public Instruction
 {
 public:
-    PushFuncInstruction(const std::string& funcName)
+    PushFuncInstruction(std::string_view funcName)
         : Instruction(Type::PUSH), funcName(funcName)
     {}
 
@@ -200,7 +201,7 @@ public:
 class FuncDeclInstruction : public Instruction
 {
 public:
-    FuncDeclInstruction(const std::string& funcName)
+    FuncDeclInstruction(std::string_view funcName)
         : Instruction(Type::FUNC_DECL), funcName(funcName)
     {}
 
@@ -0,0 +1,134 @@
+// Measures the per-byte cost of Lexer::CatChar against the <cctype> classification it
+// replaced, and checks that both classify every ASCII byte the same way. Not part of
+// the compiler's build. From the Compiler directory:
+//   g++ -std=c++20 -O2 -I. Lexer/ByteClassBenchmark.cpp Lexer/Lexer.cpp -o ByteClassBenchmark
+//   ./ByteClassBenchmark src/*.parl
+#include "Lexer.h"
+
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using Lexeme = Lexer::Lexeme;
+
+namespace
+{
+    // The classification before the table, kept as the baseline
+    Lexeme LibcCatChar(char c)
+    {
+        if (std::isalpha(c))
+        {
+            char lowerC = std::tolower(c);
+            if (lowerC >= 'a' && lowerC <= 'f')
+                return Lexeme::HEX_LETTER;
+            return Lexeme::LETTER;
+        }
+        else if (std::isdigit(c))
+        {
+            return Lexeme::DIGIT;
+        }
+        else if (c != '\n' && std::isspace(c))
+        {
+            return Lexeme::WHITESPACE;
+        }
+
+        switch (c)
+        {
+        case '=': return Lexeme::EQUALS;
+        case '>': return Lexeme::GREATER_THAN;
+        case '<': return Lexeme::LESS_THAN;
+        case '!': return Lexeme::EXCLAMATION;
+        case '+': return Lexeme::PLUS;
+        case '-': return Lexeme::DASH;
+        case '*': return Lexeme::ASTERISK;
+        case '/': return Lexeme::FORWARD_SLASH;
+        case '(': return Lexeme::OPEN_PAREN;
+        case ')': return Lexeme::CLOSE_PAREN;
+        case '[': return Lexeme::OPEN_SQ_BRACK;
+        case ']': return Lexeme::CLOSE_SQ_BRACK;
+        case '{': return Lexeme::OPEN_CURLY_BRACK;
+        case '}': return Lexeme::CLOSE_CURLY_BRACK;
+        case '_': return Lexeme::UNDERSCORE;
+        case ',': return Lexeme::COMMA;
+        case '.': return Lexeme::FULLSTOP;
+        case ':': return Lexeme::COLON;
+        case ';': return Lexeme::SEMICOLON;
+        case '\n': return Lexeme::NEW_LINE;
+        case '#': return Lexeme::HASHTAG;
+        case '%': return Lexeme::PERCENT;
+        }
+
+        return Lexeme::OTHER;
+    }
+
+    // Both are called through a pointer so neither is inlined into the loop
+    using Classifier = Lexeme(*)(char);
+
+    Lexeme TableCatChar(char c) { return Lexer::CatChar(c); }
+
+    // Best of several passes over the text, in nanoseconds per byte
+    double NsPerByte(Classifier classify, const std::string& text, size_t& checksum)
+    {
+        constexpr int PASSES = 5;
+        double best = 1e30;
+        for (int pass = 0; pass < PASSES; pass++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (char c : text)
+                checksum += (size_t)classify(c);
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count() / text.size());
+        }
+        return best;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <file.parl>...\n";
+        return 1;
+    }
+
+    for (int c = 0; c < 128; c++)
+    {
+        if (LibcCatChar((char)c) != Lexer::CatChar((char)c))
+        {
+            std::cerr << "Byte " << c << " is classified differently\n";
+            return 1;
+        }
+    }
+
+    std::ostringstream files;
+    for (int i = 1; i < argc; i++)
+    {
+        std::ifstream file(argv[i], std::ios::binary);
+        files << file.rdbuf();
+    }
+
+    // Repeated so each pass takes long enough to time
+    constexpr int REPEATS = 300;
+    std::string text;
+    for (int i = 0; i < REPEATS; i++)
+        text += files.str();
+
+    if (text.empty())
+    {
+        std::cerr << "No input\n";
+        return 1;
+    }
+
+    volatile Classifier libc = LibcCatChar;
+    volatile Classifier table = TableCatChar;
+    size_t checksum = 0;
+    double libcCost = NsPerByte(libc, text, checksum);
+    double tableCost = NsPerByte(table, text, checksum);
+
+    std::cout << text.size() << " bytes\n";
+    std::cout << "cctype and switch: " << libcCost << " ns/byte\n";
+    std::cout << "byte class table:  " << tableCost << " ns/byte\n";
+    std::cout << "(checksum " << checksum << ")\n";
+}
@@ -1,75 +1,257 @@
 #include "Lexer.h"
-#include <cctype>
+#include "Utils/FastScan.h"
 
 using namespace Tokens;
 
-Lexer::Lexer()
-    : transitions(Table<int>((int)Lexeme::LAST + 1, NUM_STATES, -1))
+std::vector<Token> Lexer::Tokenize(std::string_view program)
 {
-    InitTable();
+    std::vector<Token> tokens;
+    tokens.reserve(program.length() / 4);
+
+    TokenizeRange(program, 0, tokens);
+    tokens.push_back(Token(Token::Type::END_OF_FILE, " ", (uint32_t)program.length()));
+
+    return tokens;
 }
 
-Scope<Token> Lexer::PeekNextToken(const std::string& program, int& index, bool excludeWhitespace, bool excludeComments)
+std::vector<Token> Lexer::TokenizeParallel(std::string_view program, ThreadPool& pool)
 {
-    Scope<Token> nextToken = GetNextToken(program, index);
-    bool inLineComment = nextToken->type == Token::Type::LINE_COMMENT;
-    bool inBlockComment = nextToken->type == Token::Type::BLOCK_COMMENT && nextToken->As<BlockComment>().open;
+    const char* begin = program.data();
+    const char* end = begin + program.length();
+
+    // Splits the program just after newlines. No token other than a block comment
+    // crosses a newline, so each chunk can be lexed on its own
+    size_t numChunks = std::min(pool.size() * 4, program.length() / MIN_CHUNK_SIZE);
+    std::vector<size_t> bounds{ 0 };
+    for (size_t i = 1; i < numChunks; i++)
+    {
+        const char* newLine = FastScan::FindByte(begin + program.length() * i / numChunks, end, '\n');
+        size_t bound = newLine + 1 - begin;
+        if (newLine != end && bound > bounds.back() && bound < program.length())
+            bounds.push_back(bound);
+    }
+    bounds.push_back(program.length());
+    numChunks = bounds.size() - 1;
+
+    if (numChunks < 2)
+        return Tokenize(program);
 
-    // Skips over whitespace and comments
-    while ((excludeWhitespace && (nextToken->type == Token::Type::WHITE_SPACE || nextToken->type == Token::Type::NEW_LINE)) ||
-        (excludeComments && (nextToken->type == Token::Type::BLOCK_COMMENT || inLineComment || inBlockComment)))
+    struct Chunk
     {
-        index += nextToken->lexemeLength;
-        nextToken = GetNextToken(program, index);
+        std::vector<Token> tokens;
+        // Identifiers are interned per chunk and merged afterwards
+        Scope<StringInterner> interner;
+        bool endsInBlockComment = false;
+    };
+
+    std::vector<Chunk> chunks(numChunks);
+    auto lexChunk = [&](size_t i, size_t start)
+    {
+        Chunk& chunk = chunks[i];
+        chunk.tokens.clear();
+        chunk.tokens.reserve((bounds[i + 1] - start) / 4);
+        chunk.interner = CreateScope<StringInterner>();
+
+        Lexer chunkLexer(*chunk.interner);
+        chunk.endsInBlockComment = chunkLexer.TokenizeRange(program.substr(0, bounds[i + 1]), (int)start, chunk.tokens);
+    };
 
-        if (inLineComment)
+    // Every chunk is first lexed assuming it does not start inside a block comment
+    pool.ParallelFor(numChunks, [&](size_t i) { lexChunk(i, bounds[i]); });
+
+    // Relexes chunks that actually start inside a comment opened in an earlier chunk
+    for (size_t i = 1; i < numChunks; i++)
+    {
+        if (!chunks[i - 1].endsInBlockComment)
+            continue;
+
+        const char* chunkEnd = begin + bounds[i + 1];
+        const char* close = FastScan::FindPair(begin + bounds[i], chunkEnd, '*', '/');
+        if (close == chunkEnd)
         {
-            if(nextToken->type == Token::Type::NEW_LINE)
-                inLineComment = false;
+            // The whole chunk is inside the comment
+            chunks[i].tokens.clear();
+            chunks[i].interner = CreateScope<StringInterner>();
+            chunks[i].endsInBlockComment = true;
         }
         else
         {
-            inLineComment = nextToken->type == Token::Type::LINE_COMMENT;
+            lexChunk(i, close + 2 - begin);
         }
+    }
+
+    // Interning each chunk's symbols in chunk order hands out the same IDs as lexing sequentially
+    std::vector<std::vector<SymbolID>> symbolRemaps(numChunks);
+    std::vector<size_t> offsets(numChunks + 1, 0);
+    for (size_t i = 0; i < numChunks; i++)
+    {
+        const StringInterner& chunkInterner = *chunks[i].interner;
+        symbolRemaps[i].resize(chunkInterner.size());
+        for (SymbolID symbol = 0; symbol < chunkInterner.size(); symbol++)
+            symbolRemaps[i][symbol] = interner->Intern(chunkInterner[symbol]);
 
-        if (inBlockComment)
+        offsets[i + 1] = offsets[i] + chunks[i].tokens.size();
+    }
+
+    std::vector<Token> tokens(offsets[numChunks] + 1);
+    pool.ParallelFor(numChunks, [&](size_t i)
+    {
+        Token* out = tokens.data() + offsets[i];
+        for (const Token& token : chunks[i].tokens)
         {
-            if (nextToken->type == Token::Type::BLOCK_COMMENT && !nextToken->As<BlockComment>().open)
-                inBlockComment = false;
+            *out = token;
+            if (token.type == Token::Type::IDENTIFIER)
+                out->symbolID = symbolRemaps[i][token.symbolID];
+            out++;
         }
-        else
+    });
+    tokens.back() = Token(Token::Type::END_OF_FILE, " ", (uint32_t)program.length());
+
+    return tokens;
+}
+
+template<typename F>
+bool Lexer::LexTokens(std::string_view program, int index, F&& onToken)
+{
+    const char* begin = program.data();
+    const char* end = begin + program.length();
+
+    while (index < (int)program.length())
+    {
+        // Skips runs of whitespace and newlines without going through the DFA
+        Lexeme lexeme = CatChar(program[index]);
+        if (lexeme == Lexeme::WHITESPACE || lexeme == Lexeme::NEW_LINE)
+        {
+            index = (int)(FastScan::SkipWhitespace(begin + index, end) - begin);
+            continue;
+        }
+
+        Token token = GetNextToken(program, index);
+        index += token.lexemeLength;
+
+        switch (token.type)
         {
-            inBlockComment = nextToken->type == Token::Type::BLOCK_COMMENT && nextToken->As<BlockComment>().open;
+        case Token::Type::LINE_COMMENT:
+            // Jumps to the newline ending the comment
+            index = (int)(FastScan::FindByte(begin + index, end, '\n') - begin);
+            break;
+        case Token::Type::BLOCK_COMMENT:
+            // Jumps past the "*/" ending the comment. An unterminated comment runs
+            // to the end of the program and stray closes are ignored
+            if (token.As<BlockComment>().open)
+            {
+                const char* close = FastScan::FindPair(begin + index, end, '*', '/');
+                if (close == end)
+                    return true;
+
+                index = (int)(close + 2 - begin);
+            }
+            break;
+        case Token::Type::WHITE_SPACE:
+        case Token::Type::NEW_LINE:
+            break;
+        default:
+            if (!onToken(token))
+                return false;
         }
     }
 
-    return std::move(nextToken);
+    return false;
 }
 
-Scope<Token> Lexer::GetNextToken(const std::string& program, int& index, bool excludeWhitespace, bool excludeComments)
+bool Lexer::TokenizeRange(std::string_view program, int index, std::vector<Token>& tokens)
 {
-    auto token = PeekNextToken(program, index, excludeWhitespace, excludeComments);
-    index += token->lexemeLength;
-    return std::move(token);
+    return LexTokens(program, index, [&](const Token& token)
+    {
+        tokens.push_back(token);
+        return true;
+    });
 }
 
-Scope<Token> Lexer::GetNextToken(const std::string& program, int index)
+Lexer::RelexResult Lexer::Relex(std::string_view program, std::vector<Token> tokens, const Edit& edit)
 {
-    if (index >= program.length())
-        return std::move(CreateScope<Token>(Token::Type::END_OF_FILE, " ", index));
+    int64_t shift = (int64_t)edit.insertedLength - (int64_t)edit.removedLength;
+    uint32_t oldEditEnd = edit.offset + edit.removedLength;
+    uint32_t newEditEnd = edit.offset + edit.insertedLength;
+
+    // First old token starting at or after the edit. The DFA reads at most two characters
+    // past the end of a token, so the token before the one the edit falls in is the
+    // last one whose lexing cannot have looked at the edited text
+    auto byStart = [](const Token& token, uint32_t index) { return token.startIndex < index; };
+    size_t afterEdit = std::lower_bound(tokens.begin(), tokens.end() - 1, edit.offset, byStart) - tokens.begin();
+    size_t first = afterEdit >= 2 ? afterEdit - 2 : 0;
+
+    // Every old token start is where the lexer was outside of any comment, so lexing
+    // restarts at one and is back in step once a new token after the edit starts
+    // where an old one did. Otherwise it runs to the end, which also covers block
+    // comments that now run to the end of the program
+    int index = afterEdit > 0 ? (int)tokens[first].startIndex : 0;
+    size_t oldEnd = std::lower_bound(tokens.begin() + first, tokens.end() - 1, oldEditEnd, byStart) - tokens.begin();
+
+    std::vector<Token> relexed;
+    bool inStep = false;
+    LexTokens(program, index, [&](const Token& token)
+    {
+        if (token.startIndex >= newEditEnd)
+        {
+            while (oldEnd < tokens.size() - 1 && tokens[oldEnd].startIndex + shift < token.startIndex)
+                oldEnd++;
+
+            inStep = tokens[oldEnd].startIndex + shift == token.startIndex;
+            if (inStep)
+                return false;
+        }
+
+        relexed.push_back(token);
+        return true;
+    });
 
+    if (!inStep)
+        oldEnd = tokens.size() - 1;
+
+    // Splices the relexed tokens in and moves the rest by the edit
+    for (size_t i = oldEnd; i < tokens.size(); i++)
+        tokens[i].startIndex = (uint32_t)(tokens[i].startIndex + shift);
+
+    if (relexed.size() > oldEnd - first)
+        tokens.insert(tokens.begin() + oldEnd, relexed.size() - (oldEnd - first), Token{});
+    else
+        tokens.erase(tokens.begin() + first + relexed.size(), tokens.begin() + oldEnd);
+    std::copy(relexed.begin(), relexed.end(), tokens.begin() + first);
+
+    return { std::move(tokens), first, oldEnd, first + relexed.size() };
+}
+
+Token Lexer::GetNextToken(std::string_view program, int index)
+{
+    if (index >= (int)program.length())
+        return Token(Token::Type::END_OF_FILE, " ", index);
+
+#ifdef LEXER_DIRECT_CODED
+    return ScanDirect(program, index);
+#else
+    return ScanTable(program, index);
+#endif
+}
+
+Token Lexer::ScanTable(std::string_view program, int index)
+{
     int state = 0;
     int lastAccState = -1;
     int lastIndex = -1;
 
     int i = index;
 
-    for (;i < program.length() && state != -1; i++)
+    for (;i < (int)program.length(); i++)
     {
-        char currentChar = program[i];
+        state = NextState(state, program[i]);
 
-        Lexer::Lexeme cat = CatChar(currentChar);
-        state = transitions[state][(int)cat];
+        if (state == -1)
+        {
+            // The character that ended the token counts towards error tokens
+            i++;
+            break;
+        }
 
         if (Accepted(state))
         {
@@ -78,18 +260,39 @@ Scope<Token> Lexer::GetNextToken(const std::string& program, int index)
         }
     }
 
+    return CreateToken(program, index, i, lastAccState, lastIndex);
+}
+
+Token Lexer::ScanDirect(std::string_view program, int index)
+{
+    return LeaveState<0>(program, index, index, -1, -1);
+}
+
+Token Lexer::CreateToken(std::string_view program, int index, int end, int lastAccState, int lastIndex)
+{
     if (lastAccState == -1)
     {
-        return CreateScope<Token>(i - index);
+        return Token(Token::Type::ERROR, program.substr(index, end - index), index);
     }
 
     // Returns a token according to the final state
-    return std::move(GetTokenByFinalState(lastAccState, program.substr(index, lastIndex - index + 1), index));
+    std::string_view lexeme = program.substr(index, lastIndex - index + 1);
+    Token token = GetTokenByFinalState(lastAccState, lexeme, index);
+
+    // Identifiers carry their symbol so later stages never need the text
+    if (token.type == Token::Type::IDENTIFIER)
+        token.symbolID = interner->Intern(lexeme);
+
+    return token;
 }
 
 // Creates the transition table
-void Lexer::InitTable()
+constexpr Lexer::TransitionTable Lexer::InitTable()
 {
+    TransitionTable transitions{};
+    for (auto& row : transitions)
+        row.fill(-1);
+
     #pragma region Integers
         transitions[0][(int)Lexeme::DIGIT] = 1;
         transitions[1][(int)Lexeme::DIGIT] = 1;
@@ -209,36 +412,41 @@ void Lexer::InitTable()
         transitions[37][(int)Lexeme::LETTER] = 37;
     #pragma endregion
 
+    return transitions;
 }
 
-Scope<Token> Lexer::GetTokenByFinalState(int state, const std::string& lexeme, uint32_t startIndex)
+constexpr Lexer::TransitionTable Lexer::transitions = Lexer::InitTable();
+
+constexpr Lexer::FinalStateTable Lexer::InitFinalStates()
 {
-    switch (state)
-    {
-        // Assumes the token class has a static Create function
-#define X(cls, state) case state: return std::move(cls::Create(lexeme, startIndex)); 
-        TOKEN_FINAL_STATE
+    FinalStateTable finalStates{};
+
+    // Assumes the token class has a static Create function
+#define X(cls, state) finalStates[state] = &cls::Create;
+    TOKEN_FINAL_STATE
 #undef X
-    }
 
-    return std::move(std::make_unique<Token>(lexeme.length()));
+    return finalStates;
 }
 
+constexpr Lexer::FinalStateTable Lexer::finalStates = Lexer::InitFinalStates();
+
 // Converts characters to lexemes
-Lexer::Lexeme Lexer::CatChar(char c)
+// Only ASCII is classified, all other bytes are OTHER
+constexpr Lexer::Lexeme Lexer::ClassifyByte(unsigned char c)
 {
-    if (std::isalpha(c))
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
     {
-        char lowerC = std::tolower(c);
+        char lowerC = c | 0x20;
         if (lowerC >= 'a' && lowerC <= 'f')
             return Lexeme::HEX_LETTER;
         return Lexeme::LETTER;
     }
-    else if (std::isdigit(c))
+    else if (c >= '0' && c <= '9')
     {
         return Lexeme::DIGIT;
     }
-    else if (c != '\n' && std::isspace(c))
+    else if (c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r')
     {
         return Lexeme::WHITESPACE;
     }
@@ -294,3 +502,154 @@ Lexer::Lexeme Lexer::CatChar(char c)
     return Lexeme::OTHER;
 }
 
+constexpr Lexer::ByteClassTable Lexer::InitByteClasses()
+{
+    ByteClassTable byteClasses{};
+    for (int c = 0; c < 256; c++)
+        byteClasses[c] = ClassifyByte((unsigned char)c);
+
+    return byteClasses;
+}
+
+constexpr Lexer::ByteClassTable Lexer::byteClasses = Lexer::InitByteClasses();
+
+// Folds the byte classes into the transitions
+constexpr Lexer::FusedTransitionTable Lexer::InitFusedTable()
+{
+    FusedTransitionTable fusedTransitions{};
+    for (int state = 0; state < NUM_STATES; state++)
+    {
+        for (int c = 0; c < 256; c++)
+            fusedTransitions[state][c] = transitions[state][(int)byteClasses[c]];
+    }
+
+    return fusedTransitions;
+}
+
+#ifdef LEXER_FUSED_TABLE
+constexpr Lexer::FusedTransitionTable Lexer::fusedTransitions = Lexer::InitFusedTable();
+#endif
+
+// Splits every row of the fused table into runs of bytes with the same next state
+constexpr Lexer::StateRangeTable Lexer::InitStateRanges()
+{
+    FusedTransitionTable fusedTransitions = InitFusedTable();
+    StateRangeTable stateRanges{};
+    for (int state = 0; state < NUM_STATES; state++)
+    {
+        StateRanges& ranges = stateRanges[state];
+        ranges.accepting = finalStates[state] != nullptr;
+
+        for (int c = 0; c < 256; c++)
+        {
+            int8_t next = fusedTransitions[state][c];
+            if (c > 0 && ranges.ranges[ranges.count - 1].state == next)
+                continue;
+
+            // Fails compilation when the table is built in a constant expression
+            if (ranges.count == MAX_STATE_RANGES)
+                throw "Too many byte ranges in a state, increase MAX_STATE_RANGES";
+
+            ranges.ranges[ranges.count++] = { (unsigned char)c, next };
+        }
+    }
+
+    return stateRanges;
+}
+
+constexpr Lexer::StateRangeTable Lexer::stateRanges = Lexer::InitStateRanges();
+
+constexpr bool Lexer::RangesGoTo(int state, int first, int last, int target)
+{
+    for (int range = first; range < last; range++)
+    {
+        if (stateRanges[state].ranges[range].state != target)
+            return false;
+    }
+
+    return true;
+}
+
+constexpr bool Lexer::AnyRangeGoesTo(int state, int first, int last, int target)
+{
+    for (int range = first; range < last; range++)
+    {
+        if (stateRanges[state].ranges[range].state == target)
+            return true;
+    }
+
+    return false;
+}
+
+template<int State>
+Token Lexer::ScanState(std::string_view program, int index, int i, int lastAccState, int lastIndex)
+{
+    // Loops in the state without a call, only other transitions leave the function
+    while (true)
+    {
+        if constexpr (stateRanges[State].accepting)
+        {
+            lastAccState = State;
+            lastIndex = i;
+        }
+
+        if (++i >= (int)program.length())
+            return CreateToken(program, index, i, lastAccState, lastIndex);
+
+        if (!StaysInState<State, 0, stateRanges[State].count>((unsigned char)program[i]))
+            return LeaveState<State>(program, index, i, lastAccState, lastIndex);
+    }
+}
+
+template<int State>
+Token Lexer::LeaveState(std::string_view program, int index, int i, int lastAccState, int lastIndex)
+{
+    return LeaveStateBy<State, 0, stateRanges[State].count>(program, index, i, lastAccState, lastIndex);
+}
+
+template<int State, int First, int Last>
+Token Lexer::LeaveStateBy(std::string_view program, int index, int i, int lastAccState, int lastIndex)
+{
+    constexpr int8_t next = stateRanges[State].ranges[First].state;
+    if constexpr (RangesGoTo(State, First, Last, next))
+    {
+        if constexpr (next == -1)
+        {
+            // The character that ended the token counts towards error tokens
+            return CreateToken(program, index, i + 1, lastAccState, lastIndex);
+        }
+        else
+        {
+            return ScanState<next>(program, index, i, lastAccState, lastIndex);
+        }
+    }
+    else
+    {
+        constexpr int middle = (First + Last) / 2;
+        if ((unsigned char)program[i] < stateRanges[State].ranges[middle].first)
+            return LeaveStateBy<State, First, middle>(program, index, i, lastAccState, lastIndex);
+        else
+            return LeaveStateBy<State, middle, Last>(program, index, i, lastAccState, lastIndex);
+    }
+}
+
+template<int State, int First, int Last>
+bool Lexer::StaysInState(unsigned char c)
+{
+    if constexpr (!AnyRangeGoesTo(State, First, Last, State))
+    {
+        return false;
+    }
+    else if constexpr (RangesGoTo(State, First, Last, State))
+    {
+        return true;
+    }
+    else
+    {
+        constexpr int middle = (First + Last) / 2;
+        if (c < stateRanges[State].ranges[middle].first)
+            return StaysInState<State, First, middle>(c);
+        else
+            return StaysInState<State, middle, Last>(c);
+    }
+}
@@ -1,14 +1,28 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <initializer_list>
 #include <array>
+#include <vector>
+#include <cstdint>
 #include <memory>
+#include <algorithm>
 
-#include "../Utils/Table.h"
 #include "Tokens.h"
+#include "Utils/ThreadPool.h"
 
 using namespace Tokens;
 
+// Define LEXER_FUSED_TABLE to look up transitions in a single [state][byte] table
+// instead of classifying the byte first. Saves a load per byte for ~10KB of table
+//#define LEXER_FUSED_TABLE
+
+// Define LEXER_DIRECT_CODED to have GetNextToken scan with code generated from the
+// transition table at compile time instead of looking transitions up. Every state becomes
+// its own function that picks the next state by binary searching byte ranges, like re2c
+// output. Both scanners are compiled either way, see Lexer/ScannerTest.cpp
+//#define LEXER_DIRECT_CODED
+
 class Lexer
 {
 public:
@@ -88,47 +102,156 @@ public:
         X(NewLine, 26) 
 
 public:
-    Lexer();
+    Lexer() = default;
+
+    // Identifiers are interned into the given interner instead of the global one
+    Lexer(StringInterner& interner)
+        : interner(&interner)
+    {}
+
+    // Lexes the whole program into a token buffer, skipping whitespace and comments.
+    // The last token is always END_OF_FILE
+    std::vector<Token> Tokenize(std::string_view program);
+
+    // Same tokens and symbol IDs as Tokenize, but the program is split into chunks at
+    // newlines that are lexed on the pool. Small programs are lexed sequentially
+    std::vector<Token> TokenizeParallel(std::string_view program, ThreadPool& pool);
 
-    Table<int>::RefCol operator[](int x)
+    // Programs at least this big are worth lexing in parallel
+    static constexpr size_t PARALLEL_SIZE = 1024 * 1024;
+
+    // Replaces removedLength characters at offset with insertedLength new ones
+    struct Edit
     {
-        return transitions[x];
-    }
+        uint32_t offset;
+        uint32_t removedLength;
+        uint32_t insertedLength;
+    };
+
+    // Tokens [first, newEnd) of the result replaced tokens [first, oldEnd) of the old program
+    struct RelexResult
+    {
+        std::vector<Token> tokens;
+        size_t first;
+        size_t oldEnd;
+        size_t newEnd;
+    };
+
+    // Updates the tokens of a program after an edit, given the program with the edit
+    // applied. Only the text from the token before the edit up to where the tokens are
+    // back in step is lexed again. The old tokens must come from Tokenize or Relex with
+    // the same interner
+    RelexResult Relex(std::string_view program, std::vector<Token> tokens, const Edit& edit);
+
+    // Gets the token starting at the given index
+    Token GetNextToken(std::string_view program, int index);
+
+    // The scanners GetNextToken can be built with, which must give the same tokens. Both
+    // are always compiled so they can be tested against each other. The index must be
+    // inside the program
+    Token ScanTable(std::string_view program, int index);
+    Token ScanDirect(std::string_view program, int index);
+
+    // Class of a byte, a single load from the table built by InitByteClasses
+    static inline Lexeme CatChar(char c) { return byteClasses[(unsigned char)c]; }
+
+private:
+    // Lexes from the index to the end of the program, without adding END_OF_FILE.
+    // Returns whether the program ends inside an unterminated block comment
+    bool TokenizeRange(std::string_view program, int index, std::vector<Token>& tokens);
 
-    // Gets the next token and increments the program index to point to the next token
-    Scope<Token> GetNextToken(const std::string& program, int& index, bool excludeWhitespace, bool excludeComments);
+    // Calls onToken with every token from the index that is not whitespace or a comment,
+    // until it returns false. Returns whether the program ends inside an unterminated block comment
+    template<typename F>
+    bool LexTokens(std::string_view program, int index, F&& onToken);
 
-    // Gets the next token without incrementing the program index
-    Scope<Token> PeekNextToken(const std::string& program, int& index, bool excludeWhitespace, bool excludeComments);
+    // Creates the token for the last accepting state reached, or an error token
+    // running up to end if no state was accepting
+    Token CreateToken(std::string_view program, int index, int end, int lastAccState, int lastIndex);
 
-    // Gets the next token and increments the program index to point to the next token
-    Scope<Token> GetNextToken(const std::string& program, int index);
+    // The character at i has moved the DFA into State
+    template<int State>
+    Token ScanState(std::string_view program, int index, int i, int lastAccState, int lastIndex);
+    // Moves out of State on the character at i
+    template<int State>
+    Token LeaveState(std::string_view program, int index, int i, int lastAccState, int lastIndex);
+    // Binary searches the ranges [First, Last) of State for the character at i
+    template<int State, int First, int Last>
+    Token LeaveStateBy(std::string_view program, int index, int i, int lastAccState, int lastIndex);
+    template<int State, int First, int Last>
+    static bool StaysInState(unsigned char c);
 
 private:
-    void InitTable();
+    static constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;
 
-    inline bool Accepted(int state)
+    static constexpr int NUM_STATES = 39;
+    static constexpr int NUM_LEXEMES = (int)Lexeme::LAST + 1;
+
+    // Indexed by [state][lexeme], with -1 as the dead state
+    using TransitionTable = std::array<std::array<int8_t, NUM_LEXEMES>, NUM_STATES>;
+    using ByteClassTable = std::array<Lexeme, 256>;
+    using FusedTransitionTable = std::array<std::array<int8_t, 256>, NUM_STATES>;
+    // Creates the token for an accepting state, null for states that are not accepting
+    using TokenCreator = Token(*)(std::string_view lexeme, uint32_t startIndex);
+    using FinalStateTable = std::array<TokenCreator, NUM_STATES>;
+
+    static constexpr TransitionTable InitTable();
+    static constexpr Lexeme ClassifyByte(unsigned char c);
+    static constexpr ByteClassTable InitByteClasses();
+    static constexpr FusedTransitionTable InitFusedTable();
+    static constexpr FinalStateTable InitFinalStates();
+
+    static constexpr int MAX_STATE_RANGES = 64;
+
+    // Bytes from first up to the first byte of the next range, which all move the DFA to state
+    struct ByteRange
     {
-        for (int a : acceptedStates)
-        {
-            if (a == state)
-                return true;
-        }
+        unsigned char first;
+        int8_t state;
+    };
+    // Transitions out of a state as sorted ranges covering every byte
+    struct StateRanges
+    {
+        std::array<ByteRange, MAX_STATE_RANGES> ranges{};
+        int count = 0;
+        bool accepting = false;
+    };
+    using StateRangeTable = std::array<StateRanges, NUM_STATES>;
 
-        return false;
-    }
+    static constexpr StateRangeTable InitStateRanges();
+    // Whether every range in [first, last) of the state goes to target
+    static constexpr bool RangesGoTo(int state, int first, int last, int target);
+    // Whether any range in [first, last) of the state goes to target
+    static constexpr bool AnyRangeGoesTo(int state, int first, int last, int target);
 
-    Scope<Token> GetTokenByFinalState(int state, const std::string& lexeme, uint32_t startIndex);
+    static inline bool Accepted(int state) { return finalStates[state] != nullptr; }
 
-    Lexeme CatChar(char c);
+    static inline Token GetTokenByFinalState(int state, std::string_view lexeme, uint32_t startIndex)
+    {
+        return finalStates[state](lexeme, startIndex);
+    }
+
+    static inline int NextState(int state, char c)
+    {
+#ifdef LEXER_FUSED_TABLE
+        return fusedTransitions[state][(unsigned char)c];
+#else
+        return transitions[state][(int)CatChar(c)];
+#endif
+    }
 
 private:
-    const int NUM_STATES = 39;
-    Table<int> transitions;
-#define X(cls, state) + 1
-    static const int NUM_FINAL_STATES = 0 TOKEN_FINAL_STATE;
-#undef X
-#define X(cls, state) state,
-    std::array<int, NUM_FINAL_STATES> acceptedStates = { TOKEN_FINAL_STATE };
-#undef X
+    // Built at compile time by InitTable
+    static const TransitionTable transitions;
+    // Lexeme of every byte, built at compile time by InitByteClasses
+    static const ByteClassTable byteClasses;
+#ifdef LEXER_FUSED_TABLE
+    static const FusedTransitionTable fusedTransitions;
+#endif
+    // Only read at compile time to generate the scanner
+    static const StateRangeTable stateRanges;
+    // Token created by each accepting state, built at compile time from TOKEN_FINAL_STATE
+    static const FinalStateTable finalStates;
+
+    StringInterner* interner = &StringInterner::Global();
 };
\ No newline at end of file
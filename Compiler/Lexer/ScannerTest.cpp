@@ -0,0 +1,230 @@
+// Checks that the table-driven and direct-coded scanners give the same token at every
+// offset of random programs and of the given files, then that Tokenize, which uses the
+// scanner the build selected, lexes the files the same as walking either scanner. Last,
+// checks that Relex after an edit gives the tokens of lexing the edited program again,
+// for chosen edits and random ones to the random programs and files. Not part of the
+// compiler's build. Run it in both configurations, from the Compiler directory:
+//   g++ -std=c++20 -O2 -I. Lexer/ScannerTest.cpp Lexer/Lexer.cpp -o ScannerTest
+//   g++ -std=c++20 -O2 -I. -DLEXER_DIRECT_CODED Lexer/ScannerTest.cpp Lexer/Lexer.cpp -o ScannerTestDirect
+//   ./ScannerTest src/*.parl && ./ScannerTestDirect src/*.parl
+#include "Lexer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    bool SameToken(const Token& a, const Token& b)
+    {
+        return a.type == b.type && a.subType == b.subType && a.lexemeLength == b.lexemeLength &&
+            a.startIndex == b.startIndex && a.intValue == b.intValue;
+    }
+
+    // Pieces random programs are made from, weighted towards the ones the DFA branches on
+    const std::vector<std::string> PIECES = {
+        "0", "7", "42", "1.5", "3.", ".", "#", "#ff00aa", "#12", "abc", "fAce", "x_1", "_", "let", "fun",
+        "true", "false", "float", "int", "__width", "__randi", "+", "-", "->", "*", "/", "%", "<", "<=",
+        ">", ">=", "==", "!=", "!", "=", "(", ")", "[", "]", "{", "}", ",", ":", ";", " ", "\t", "\n",
+        "\r\n", "//", "/*", "*/", "$", "\x80", "\xff", "99999999999", "1e5",
+    };
+
+    std::string RandomProgram(std::mt19937& rng)
+    {
+        std::uniform_int_distribution<size_t> piece(0, PIECES.size() - 1);
+        std::uniform_int_distribution<int> length(0, 40);
+
+        std::string program;
+        for (int i = length(rng); i > 0; i--)
+            program += PIECES[piece(rng)];
+        return program;
+    }
+
+    // Returns the number of offsets where the scanners disagree
+    int CompareAtEveryOffset(Lexer& lexer, const std::string& program, const std::string& name)
+    {
+        int mismatches = 0;
+        for (int index = 0; index < (int)program.size(); index++)
+        {
+            Token table = lexer.ScanTable(program, index);
+            Token direct = lexer.ScanDirect(program, index);
+            if (!SameToken(table, direct))
+            {
+                if (mismatches == 0)
+                    std::cerr << name << ": scanners differ at offset " << index << "\n";
+                mismatches++;
+            }
+        }
+        return mismatches;
+    }
+
+    // The tokens Tokenize should give, by walking one scanner over the program
+    template<typename Scan>
+    std::vector<Token> Walk(const std::string& program, Scan&& scan)
+    {
+        std::vector<Token> tokens;
+        for (int index = 0; index < (int)program.size();)
+        {
+            Token token = scan(index);
+            index += std::max(1u, token.lexemeLength);
+            switch (token.type)
+            {
+            // The DFA only matches the start of a comment, the rest is skipped here
+            case Token::Type::LINE_COMMENT:
+                index = (int)std::min(program.find('\n', index), program.size());
+                break;
+            case Token::Type::BLOCK_COMMENT:
+                if (token.As<BlockComment>().open)
+                {
+                    size_t close = program.find("*/", index);
+                    index = close == std::string::npos ? (int)program.size() : (int)close + 2;
+                }
+                break;
+            case Token::Type::WHITE_SPACE:
+            case Token::Type::NEW_LINE:
+                break;
+            default:
+                tokens.push_back(token);
+            }
+        }
+        return tokens;
+    }
+
+    bool SameTokens(const std::vector<Token>& a, const std::vector<Token>& b)
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), SameToken);
+    }
+
+    // Replaces removedLength characters at offset with the inserted text, then checks that
+    // relexing the old tokens gives the tokens of lexing the edited program from scratch
+    bool CheckRelex(Lexer& lexer, const std::string& program, uint32_t offset, uint32_t removedLength,
+        const std::string& inserted, const std::string& name)
+    {
+        std::string edited = program.substr(0, offset) + inserted + program.substr(offset + removedLength);
+        Lexer::Edit edit{ offset, removedLength, (uint32_t)inserted.size() };
+
+        Lexer::RelexResult result = lexer.Relex(edited, lexer.Tokenize(program), edit);
+        if (!SameTokens(result.tokens, lexer.Tokenize(edited)))
+        {
+            std::cerr << name << ": relexing differs from lexing again\n";
+            return false;
+        }
+        return true;
+    }
+
+    // A random edit of up to a few characters, inserting pieces random programs are made from
+    bool CheckRandomRelex(Lexer& lexer, const std::string& program, std::mt19937& rng, const std::string& name)
+    {
+        uint32_t offset = std::uniform_int_distribution<uint32_t>(0, (uint32_t)program.size())(rng);
+        uint32_t maxRemoved = std::min<uint32_t>(4, (uint32_t)program.size() - offset);
+        uint32_t removedLength = std::uniform_int_distribution<uint32_t>(0, maxRemoved)(rng);
+
+        std::string inserted;
+        std::uniform_int_distribution<size_t> piece(0, PIECES.size() - 1);
+        for (int i = std::uniform_int_distribution<int>(0, 2)(rng); i > 0; i--)
+            inserted += PIECES[piece(rng)];
+
+        return CheckRelex(lexer, program, offset, removedLength, inserted, name);
+    }
+
+    // Edits where relexing has to go past the token the edit falls in, or stop early
+    int CheckChosenRelexes(Lexer& lexer)
+    {
+        const std::string program =
+            "let total:int = 42;\n"
+            "fun add(x:int, y:int) -> int { return x + y; }\n"
+            "/* block comment */ let c:colour = #ff00aa; // line comment\n"
+            "__print add(total, 1);\n";
+        auto at = [&](const std::string& text) { return (uint32_t)program.find(text); };
+
+        struct Case
+        {
+            std::string name;
+            uint32_t offset;
+            uint32_t removedLength;
+            std::string inserted;
+        };
+        const std::vector<Case> cases = {
+            { "edit inside an identifier", at("total") + 2, 1, "xyz" },
+            { "edit inside a number", at("42") + 1, 0, ".5" },
+            { "edit inside an operator", at("->") + 1, 1, "" },
+            { "join a keyword and an identifier", at("let total") + 3, 1, "" },
+            { "join across an operator", at("x + y") + 1, 3, "" },
+            { "split an identifier", at("total") + 3, 0, " " },
+            { "edit inside a block comment", at("block") + 2, 3, "xyz" },
+            { "close a block comment early", at("block") + 5, 0, "*/" },
+            { "unclose a block comment", at("*/"), 2, "" },
+            { "open a block comment", at("fun"), 0, "/*" },
+            { "edit inside a line comment", at("line") + 1, 2, "// */" },
+            { "join a line comment with the next line", at("line comment\n") + 12, 1, "" },
+            { "edit inside a colour literal", at("#ff00aa") + 3, 2, "12" },
+            { "break a colour literal", at("#ff00aa") + 1, 0, " " },
+            { "insert at the start", 0, 0, "fun f() -> int { return 1; }\n" },
+            { "join with the first token", 0, 0, "x" },
+            { "remove at the start", 0, 4, "" },
+            { "insert at the end", (uint32_t)program.size(), 0, "let end:int = 1;" },
+            { "remove at the end", (uint32_t)program.size() - 3, 3, "" },
+            { "replace everything", 0, (uint32_t)program.size(), "__print 1;" },
+        };
+
+        int failures = 0;
+        for (const Case& edit : cases)
+            failures += !CheckRelex(lexer, program, edit.offset, edit.removedLength, edit.inserted, edit.name);
+        return failures;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Lexer lexer;
+    int failures = 0;
+
+    constexpr int RANDOM_PROGRAMS = 20000;
+    std::mt19937 rng(12345);
+    for (int i = 0; i < RANDOM_PROGRAMS; i++)
+    {
+        std::string program = RandomProgram(rng);
+        std::string name = "random program " + std::to_string(i);
+        failures += CompareAtEveryOffset(lexer, program, name) > 0;
+        failures += !CheckRandomRelex(lexer, program, rng, name);
+    }
+
+    failures += CheckChosenRelexes(lexer);
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::ifstream file(argv[i], std::ios::binary);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        std::string program = contents.str();
+
+        failures += CompareAtEveryOffset(lexer, program, argv[i]) > 0;
+
+        std::vector<Token> tokens = lexer.Tokenize(program);
+        tokens.pop_back();
+        auto table = Walk(program, [&](int index) { return lexer.ScanTable(program, index); });
+        auto direct = Walk(program, [&](int index) { return lexer.ScanDirect(program, index); });
+        if (!SameTokens(tokens, table) || !SameTokens(tokens, direct))
+        {
+            std::cerr << argv[i] << ": Tokenize differs from the scanners\n";
+            failures++;
+        }
+
+        constexpr int FILE_EDITS = 100;
+        for (int edit = 0; edit < FILE_EDITS; edit++)
+            failures += !CheckRandomRelex(lexer, program, rng, argv[i]);
+    }
+
+#ifdef LEXER_DIRECT_CODED
+    const char* configuration = "direct-coded";
+#else
+    const char* configuration = "table-driven";
+#endif
+    std::cout << configuration << " build: " << RANDOM_PROGRAMS << " random programs and " << argc - 1
+        << " files, " << failures << " failed\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -1,16 +1,20 @@
 #pragma once
 #include <string>
-#include <unordered_set>
-#include <memory>
-#include <sstream>
+#include <string_view>
+#include <cstdint>
+#include <type_traits>
+#include <charconv>
+#include <system_error>
 
 #include "Utils/Utils.h"
+#include "Utils/PerfectHash.h"
+#include "Utils/StringInterner.h"
 
 namespace Tokens
 {
     struct Token
     {
-        enum class Type
+        enum class Type : uint8_t
         {
             ERROR = 0,
             WHITE_SPACE,
@@ -35,51 +39,106 @@ namespace Tokens
             END_OF_FILE,
         };
 
-        Token(int length)
-            : type(Type::ERROR), lexemeLength(length), startIndex(0)
-        {}
+        Token() = default;
 
-        Token(Type type, const std::string& lexeme, uint32_t startIndex)
+        Token(Type type, std::string_view lexeme, uint32_t startIndex)
             : type(type), lexemeLength((uint32_t)lexeme.length()), startIndex(startIndex)
         {}
 
-        virtual ~Token() = default;
-
+        // Decodes the token as one of the token classes below
         template<typename T>
-        T& As() 
+        T As() const
         {
-            return *static_cast<T*>(this);
+            return T(*this);
         }
+
+        // Tokens only store their position, so the text has to be read from the program
+        inline std::string_view Lexeme(std::string_view program) const { return program.substr(startIndex, lexemeLength); }
     public:
-        Type type;
-        uint32_t lexemeLength;
+        Type type = Type::ERROR;
+        // Type within the token class (e.g. Bracket::Type), decoded when the token is created
+        uint8_t subType = 0;
+        uint32_t lexemeLength = 0;
         uint32_t startIndex = 0;
+        // Literal value, decoded when the token is created. Identifiers hold
+        // their interned name, filled in by the lexer
+        union
+        {
+            int intValue = 0;
+            float floatValue;
+            bool boolValue;
+            SymbolID symbolID;
+        };
+    };
+
+    struct Error
+    {
+        enum class Type : uint8_t
+        {
+            INVALID = 0,
+            INT_OUT_OF_RANGE,
+            FLOAT_OUT_OF_RANGE,
+        };
+
+        Error(const Token& token)
+            : type((Type)token.subType)
+        {
+        }
+
+        static Token Create(std::string_view lexeme, uint32_t startIndex, Type type = Type::INVALID)
+        {
+            Token token(TokenType, lexeme, startIndex);
+            token.subType = (uint8_t)type;
+            return token;
+        }
+
+        // Explanation reported with the syntax error, empty for plain invalid tokens
+        std::string_view Reason() const
+        {
+            switch (type)
+            {
+            case Type::INT_OUT_OF_RANGE:
+                return "integer literal is out of range";
+            case Type::FLOAT_OUT_OF_RANGE:
+                return "float literal is out of range";
+            case Type::INVALID:
+                break;
+            }
+            return "";
+        }
+    public:
+        Type type;
+
+        static const Token::Type TokenType = Token::Type::ERROR;
     };
 
-    struct Whitespace : public Token
+    struct Whitespace
     {
-        Whitespace(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::WHITE_SPACE, lexeme, startIndex)
+        Whitespace(const Token&)
         {}
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
-            return CreateScope<Whitespace>(lexeme, startIndex);
+            return Token(TokenType, lexeme, startIndex);
         }
 
     public:
         static const Token::Type TokenType = Token::Type::WHITE_SPACE;
     };
 
-    struct IntegerLiteral : public Token
+    struct IntegerLiteral
     {
-        IntegerLiteral(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::INT_LITERAL, lexeme, startIndex), value(std::stoi(lexeme))
+        IntegerLiteral(const Token& token)
+            : value(token.intValue)
         {}
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
-            return CreateScope<IntegerLiteral>(lexeme, startIndex);
+            Token token(TokenType, lexeme, startIndex);
+            auto result = std::from_chars(lexeme.data(), lexeme.data() + lexeme.length(), token.intValue);
+            if (result.ec == std::errc::result_out_of_range)
+                return Error::Create(lexeme, startIndex, Error::Type::INT_OUT_OF_RANGE);
+            return token;
         }
     public:
         int value;
@@ -87,15 +146,19 @@ namespace Tokens
         static const Token::Type TokenType = Token::Type::INT_LITERAL;
     };
 
-    struct FloatLiteral : public Token
+    struct FloatLiteral
     {
-        FloatLiteral(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::FLOAT_LITERAL, lexeme, startIndex), value(std::stof(lexeme))
+        FloatLiteral(const Token& token)
+            : value(token.floatValue)
         {}
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
-            return CreateScope<FloatLiteral>(lexeme, startIndex);
+            Token token(TokenType, lexeme, startIndex);
+            auto result = std::from_chars(lexeme.data(), lexeme.data() + lexeme.length(), token.floatValue);
+            if (result.ec == std::errc::result_out_of_range)
+                return Error::Create(lexeme, startIndex, Error::Type::FLOAT_OUT_OF_RANGE);
+            return token;
         }
     public:
         float value;
@@ -103,19 +166,30 @@ namespace Tokens
         static const Token::Type TokenType = Token::Type::FLOAT_LITERAL;
     };
 
-    struct ColourLiteral : public Token
+    struct ColourLiteral
     {
-        ColourLiteral(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::COLOUR_LITERAL, lexeme, startIndex)
+        ColourLiteral(const Token& token)
+            : value(token.intValue)
+        {}
+
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
-            std::stringstream ss;
-            ss << std::hex << lexeme.substr(1, 6);
-            ss >> value;
+            // The lexer only accepts # followed by 6 hex digits
+            int value = 0;
+            for (int i = 1; i <= 6; i++)
+                value = (value << 4) | HexDigit(lexeme[i]);
+
+            Token token(TokenType, lexeme, startIndex);
+            token.intValue = value;
+            return token;
         }
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
+    private:
+        // Digits are 0x30-0x39 and letters are 0x41-0x46 or 0x61-0x66. The low nibble is the
+        // value of a digit, and the value minus 9 for letters, which are the only ones with bit 6 set
+        static inline int HexDigit(char c)
         {
-            return CreateScope<ColourLiteral>(lexeme, startIndex);
+            return (c & 0xF) + 9 * ((c >> 6) & 1);
         }
     public:
         int value = 0;
@@ -123,16 +197,18 @@ namespace Tokens
         static const Token::Type TokenType = Token::Type::COLOUR_LITERAL;
     };
 
-    struct BooleanLiteral : public Token
+    struct BooleanLiteral
     {
-        BooleanLiteral(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::BOOLEAN_LITERAL, lexeme, startIndex), value(lexeme == "true")
+        BooleanLiteral(const Token& token)
+            : value(token.boolValue)
         {
         }
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
-            return CreateScope<BooleanLiteral>(lexeme, startIndex);
+            Token token(TokenType, lexeme, startIndex);
+            token.boolValue = lexeme == "true";
+            return token;
         }
     public:
         bool value = false;
@@ -140,9 +216,9 @@ namespace Tokens
         static const Token::Type TokenType = Token::Type::BOOLEAN_LITERAL;
     };
 
-    struct VarType : public Token
+    struct VarType
     {
-        enum class Type
+        enum class Type : uint8_t
         {
             UNKNOWN = 0,
             FLOAT,
@@ -151,9 +227,14 @@ namespace Tokens
             COLOUR,
         };
 
-        VarType(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::VAR_TYPE, lexeme, startIndex)
+        VarType(const Token& token)
+            : type((Type)token.subType)
+        {
+        }
+
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
+            Type type = Type::UNKNOWN;
             if (lexeme == "float")
             {
                 type = Type::FLOAT;
@@ -170,11 +251,10 @@ namespace Tokens
             {
                 type = Type::COLOUR;
             }
-        }
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
-        {
-            return CreateScope<VarType>(lexeme, startIndex);
+            Token token(TokenType, lexeme, startIndex);
+            token.subType = (uint8_t)type;
+            return token;
         }
     public:
         Type type;
@@ -182,9 +262,9 @@ namespace Tokens
         static const Token::Type TokenType = Token::Type::VAR_TYPE;
     };
 
-    struct MultiplicativeOp : public Token
+    struct MultiplicativeOp
     {
-        enum class Type
+        enum class Type : uint8_t
         {
             MULTIPLY,
             DIVIDE,
@@ -192,9 +272,14 @@ namespace Tokens
             AND,
         };
 
-        MultiplicativeOp(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::MULT_OP, lexeme, startIndex)
+        MultiplicativeOp(const Token& token)
+            : type((Type)token.subType)
+        {
+        }
+
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
+            Type type;
             if (lexeme == "*")
             {
                 type = Type::MULTIPLY;
@@ -211,11 +296,10 @@ namespace Tokens
             {
                 type = Type::AND;
             }
-        }
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
-        {
-            return CreateScope<MultiplicativeOp>(lexeme, startIndex);
+            Token token(TokenType, lexeme, startIndex);
+            token.subType = (uint8_t)type;
+            return token;
         }
     public:
         Type type;
@@ -223,18 +307,23 @@ namespace Tokens
         static const Token::Type TokenType = Token::Type::MULT_OP;
     };
 
-    struct AdditiveOp : public Token
+    struct AdditiveOp
     {
-        enum class Type
+        enum class Type : uint8_t
         {
             ADD,
             SUBTRACT,
             OR,
         };
 
-        AdditiveOp(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::ADD_OP, lexeme, startIndex)
+        AdditiveOp(const Token& token)
+            : type((Type)token.subType)
+        {
+        }
+
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
+            Type type;
             if (lexeme == "+")
             {
                 type = Type::ADD;
@@ -247,11 +336,10 @@ namespace Tokens
             {
                 type = Type::OR;
             }
-        }
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
-        {
-            return CreateScope<AdditiveOp>(lexeme, startIndex);
+            Token token(TokenType, lexeme, startIndex);
+            token.subType = (uint8_t)type;
+            return token;
         }
     public:
         Type type;
@@ -259,9 +347,9 @@ namespace Tokens
         static const Token::Type TokenType = Token::Type::ADD_OP;
     };
 
-    struct RelationalOp : public Token
+    struct RelationalOp
     {
-        enum class Type
+        enum class Type : uint8_t
         {
             EQUAL,
             NOT_EQUAL,
@@ -271,9 +359,14 @@ namespace Tokens
             LESS_THAN_EQUAL,
         };
 
-        RelationalOp(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::REL_OP, lexeme, startIndex)
+        RelationalOp(const Token& token)
+            : type((Type)token.subType)
+        {
+        }
+
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
+            Type type = Type::EQUAL;
             switch (lexeme[0])
             {
             case '=':
@@ -293,11 +386,10 @@ namespace Tokens
                 type = Type::NOT_EQUAL;
                 break;
             }
-        }
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
-        {
-            return CreateScope<RelationalOp>(lexeme, startIndex);
+            Token token(TokenType, lexeme, startIndex);
+            token.subType = (uint8_t)type;
+            return token;
         }
     public:
         Type type;
@@ -305,22 +397,23 @@ namespace Tokens
         static const Token::Type TokenType = Token::Type::REL_OP;
     };
 
-    struct UnaryOp : public Token
+    struct UnaryOp
     {
-        enum class Type
+        enum class Type : uint8_t
         {
             NOT,
         };
 
-        UnaryOp(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::UNARY_OP, lexeme, startIndex)
+        UnaryOp(const Token& token)
+            : type((Type)token.subType)
         {
-            type = Type::NOT;
         }
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
-            return CreateScope<UnaryOp>(lexeme, startIndex);
+            Token token(TokenType, lexeme, startIndex);
+            token.subType = (uint8_t)Type::NOT;
+            return token;
         }
     public:
         Type type;
@@ -328,7 +421,7 @@ namespace Tokens
         static const Token::Type TokenType = Token::Type::UNARY_OP;
     };
 
-    struct Keyword : public Token
+    struct Keyword
     {
 #define KEYWORDS \
         X(float, FLOAT, VarType) \
@@ -349,58 +442,99 @@ namespace Tokens
         X(as, AS, Keyword) \
         X(fun, FUN, Keyword)
 
-        enum class Type
+        enum class Type : uint8_t
         {
 #define X(keyword, name, _) name,
             KEYWORDS
 #undef X
         };
 
-        Keyword(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::KEYWORD, lexeme, startIndex)
+        Keyword(const Token& token)
+            : type((Type)token.subType)
         {
-#define X(keyword, name, _) if(lexeme == #keyword) { type = Type::name; return;}
-            KEYWORDS
-#undef X
         }
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
+        // Returns the keyword type of the lexeme, or -1 if it is not a keyword
+        static int Find(std::string_view lexeme)
         {
-#define X(keyword, name, cls) if(lexeme == #keyword) { return CreateScope<::Tokens::cls>(lexeme, startIndex); }
-            KEYWORDS
+            return lookup.Find(lexeme);
+        }
+
+        static Token Create(std::string_view lexeme, uint32_t startIndex, Type type)
+        {
+            switch (type)
+            {
+#define X(keyword, name, cls) case Type::name: return CreateKeyword<::Tokens::cls>(lexeme, startIndex, type);
+                KEYWORDS
 #undef X
-            //return CreateScope<Keyword>(lexeme);
+            }
+
+            return Token(Token::Type::ERROR, lexeme, startIndex);
+        }
+
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
+        {
+            int type = Find(lexeme);
+            if (type == -1)
+                return Token(Token::Type::ERROR, lexeme, startIndex);
+
+            return Create(lexeme, startIndex, (Type)type);
         }
     public:
         Type type;
 
-        static const std::unordered_set<std::string> keywords;
-
         static const Token::Type TokenType = Token::Type::KEYWORD;
+
+    private:
+        template<typename T>
+        static Token CreateKeyword(std::string_view lexeme, uint32_t startIndex, Type type)
+        {
+            if constexpr (std::is_same_v<T, Keyword>)
+            {
+                Token token(TokenType, lexeme, startIndex);
+                token.subType = (uint8_t)type;
+                return token;
+            }
+            else
+            {
+                return T::Create(lexeme, startIndex);
+            }
+        }
+
+    private:
+#define X(keyword, _, __) + 1
+        static constexpr size_t NUM_KEYWORDS = 0 KEYWORDS;
+#undef X
+
+        // Keys are in the same order as Type, so a key's position is its type
+#define X(keyword, _, __) #keyword,
+        static constexpr PerfectHash<NUM_KEYWORDS> lookup{ { KEYWORDS } };
+#undef X
     };
 
-    struct Identifier : public Token
+    struct Identifier
     {
-        Identifier(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::IDENTIFIER, lexeme, startIndex), name(lexeme)
+        Identifier(const Token& token)
+            : symbol(token.symbolID)
         {}
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
-            if (Keyword::keywords.contains(lexeme))
-                return Keyword::Create(lexeme, startIndex);
+            int keyword = Keyword::Find(lexeme);
+            if (keyword != -1)
+                return Keyword::Create(lexeme, startIndex, (Keyword::Type)keyword);
 
-            return CreateScope<Identifier>(lexeme, startIndex);
+            return Token(TokenType, lexeme, startIndex);
         }
     public:
-        std::string name;
+        SymbolID symbol;
 
         static const Token::Type TokenType = Token::Type::IDENTIFIER;
     };
 
-    struct Punctuation : public Token
+    struct Punctuation
     {
-        enum class Type
+        enum class Type : uint8_t
         {
             SEMICOLON,
             COLON,
@@ -408,32 +542,33 @@ namespace Tokens
             ARROW
         };
 
-        Punctuation(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::PUNCTUATION, lexeme, startIndex)
+        Punctuation(const Token& token)
+            : type((Type)token.subType)
+        {
+        }
+
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
+            Token token(TokenType, lexeme, startIndex);
             if (lexeme == "->")
             {
-                type = Type::ARROW;
-                return;
+                token.subType = (uint8_t)Type::ARROW;
+                return token;
             }
 
             switch (lexeme[0])
             {
             case ';':
-                type = Type::SEMICOLON;
+                token.subType = (uint8_t)Type::SEMICOLON;
                 break;
             case ':':
-                type = Type::COLON;
+                token.subType = (uint8_t)Type::COLON;
                 break;
             case ',':
-                type = Type::COMMA;
+                token.subType = (uint8_t)Type::COMMA;
                 break;
             }
-        }
-
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
-        {
-            return CreateScope<Punctuation>(lexeme, startIndex);
+            return token;
         }
     public:
         Type type;
@@ -441,25 +576,24 @@ namespace Tokens
         static const Token::Type TokenType = Token::Type::PUNCTUATION;
     };
 
-    struct NewLine : public Token
+    struct NewLine
     {
-        NewLine(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::NEW_LINE, lexeme, startIndex)
+        NewLine(const Token&)
         {
         }
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
-            return CreateScope<NewLine>(lexeme, startIndex);
+            return Token(TokenType, lexeme, startIndex);
         }
 
     public:
         static const Token::Type TokenType = Token::Type::NEW_LINE;
     };
 
-    struct Bracket : public Token
+    struct Bracket
     {
-        enum class Type
+        enum class Type : uint8_t
         {
             OPEN_PAREN,
             CLOSE_PAREN,
@@ -469,35 +603,36 @@ namespace Tokens
             CLOSE_CURLY_BRACK,
         };
 
-        Bracket(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::BRACKET, lexeme, startIndex)
+        Bracket(const Token& token)
+            : type((Type)token.subType)
+        {
+        }
+
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
+            Token token(TokenType, lexeme, startIndex);
             switch (lexeme[0])
             {
             case '(':
-                type = Type::OPEN_PAREN;
+                token.subType = (uint8_t)Type::OPEN_PAREN;
                 break;
             case ')':
-                type = Type::CLOSE_PAREN;
+                token.subType = (uint8_t)Type::CLOSE_PAREN;
                 break;
             case '[':
-                type = Type::OPEN_SQ_BRACK;
+                token.subType = (uint8_t)Type::OPEN_SQ_BRACK;
                 break;
             case ']':
-                type = Type::CLOSE_SQ_BRACK;
+                token.subType = (uint8_t)Type::CLOSE_SQ_BRACK;
                 break;
             case '{':
-                type = Type::OPEN_CURLY_BRACK;
+                token.subType = (uint8_t)Type::OPEN_CURLY_BRACK;
                 break;
             case '}':
-                type = Type::CLOSE_CURLY_BRACK;
+                token.subType = (uint8_t)Type::CLOSE_CURLY_BRACK;
                 break;
             }
-        }
-
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
-        {
-            return CreateScope<Bracket>(lexeme, startIndex);
+            return token;
         }
     public:
         Type type;
@@ -505,32 +640,30 @@ namespace Tokens
         static const Token::Type TokenType = Token::Type::BRACKET;
     };
 
-    struct Assignment : public Token
+    struct Assignment
     {
-        Assignment(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::ASSIGNMENT, lexeme, startIndex)
+        Assignment(const Token&)
         {
         }
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
-            return CreateScope<Assignment>(lexeme, startIndex);
+            return Token(TokenType, lexeme, startIndex);
         }
 
     public:
         static const Token::Type TokenType = Token::Type::ASSIGNMENT;
     };
 
-    struct LineComment : public Token
+    struct LineComment
     {
-        LineComment(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::LINE_COMMENT, lexeme, startIndex)
+        LineComment(const Token&)
         {
         }
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
-            return CreateScope<LineComment>(lexeme, startIndex);
+            return Token(TokenType, lexeme, startIndex);
         }
 
     public:
@@ -538,16 +671,18 @@ namespace Tokens
 
     };
 
-    struct BlockComment : public Token
+    struct BlockComment
     {
-        BlockComment(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::BLOCK_COMMENT, lexeme, startIndex), open(lexeme == "/*")
+        BlockComment(const Token& token)
+            : open(token.boolValue)
         {
         }
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
-            return CreateScope<BlockComment>(lexeme, startIndex);
+            Token token(TokenType, lexeme, startIndex);
+            token.boolValue = lexeme == "/*";
+            return token;
         }
 
     public:
@@ -556,7 +691,7 @@ namespace Tokens
         static const Token::Type TokenType = Token::Type::BLOCK_COMMENT;
     };
 
-    struct Builtin : public Token
+    struct Builtin
     {
 #define BUILTIN_TYPES \
         X(__width, WIDTH) \
@@ -569,35 +704,42 @@ namespace Tokens
         X(__write_box, WRITE_BOX) \
         X(__write, WRITE) 
 
-        enum class Type
+        enum class Type : uint8_t
         {
 #define X(keyword, name) name,
             BUILTIN_TYPES
 #undef X
         };
 
-        Builtin(const std::string& lexeme, uint32_t startIndex)
-            : Token(Token::Type::BUILTIN, lexeme, startIndex)
+        Builtin(const Token& token)
+            : type((Type)token.subType)
         {
-#define X(keyword, name) if(lexeme == #keyword) { type = Type::name; }
-            BUILTIN_TYPES
-#undef X
         }
 
-        static Scope<Token> Create(const std::string& lexeme, uint32_t startIndex)
+        static Token Create(std::string_view lexeme, uint32_t startIndex)
         {
-            if (builtinTypes.contains(lexeme))
-            {
-                return CreateScope<Builtin>(lexeme, startIndex);
-            }
+            int type = lookup.Find(lexeme);
+            if (type == -1)
+                return Token(Token::Type::ERROR, lexeme, startIndex);
 
-            return CreateScope<Token>(lexeme.length());
+            Token token(TokenType, lexeme, startIndex);
+            token.subType = (uint8_t)type;
+            return token;
         }
 
     public:
         Type type;
-        static const std::unordered_set<std::string> builtinTypes;
 
         static const Token::Type TokenType = Token::Type::BUILTIN;
+
+    private:
+#define X(keyword, _) + 1
+        static constexpr size_t NUM_BUILTINS = 0 BUILTIN_TYPES;
+#undef X
+
+        // Keys are in the same order as Type, so a key's position is its type
+#define X(keyword, _) #keyword,
+        static constexpr PerfectHash<NUM_BUILTINS> lookup{ { BUILTIN_TYPES } };
+#undef X
     };
 }
\ No newline at end of file
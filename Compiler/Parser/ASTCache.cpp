@@ -0,0 +1,438 @@
+#include "ASTCache.h"
+#include "Utils/StringInterner.h"
+
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <vector>
+#include <unordered_map>
+#include <type_traits>
+#include <bit>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+// Nodes are written and read as they are in memory
+static_assert(std::is_trivially_copyable_v<FlatAST::Node> && sizeof(FlatAST::Node) == 24);
+
+namespace
+{
+    // Path of the running compiler, empty if it cannot be found
+    std::filesystem::path ExecutablePath()
+    {
+#ifdef _WIN32
+        wchar_t path[MAX_PATH];
+        DWORD length = GetModuleFileNameW(nullptr, path, MAX_PATH);
+        if (length == 0 || length == MAX_PATH)
+            return {};
+        return std::filesystem::path(path, path + length);
+#else
+        std::error_code error;
+        return std::filesystem::read_symlink("/proc/self/exe", error);
+#endif
+    }
+
+    // Kinds whose value is a SymbolID, which is only meaningful to the interner that made it
+    bool HasSymbol(NodeKind kind)
+    {
+        switch (kind)
+        {
+        case NodeKind::IDENTIFIER:
+        case NodeKind::ARRAY_INDEX:
+        case NodeKind::FUNCTION:
+        case NodeKind::PARAM:
+        case NodeKind::FUNC_CALL:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Children of each kind, -1 for lists. Functions have their block and then their parameters
+    int ChildCount(NodeKind kind)
+    {
+        switch (kind)
+        {
+        case NodeKind::BLOCK:
+        case NodeKind::ARRAY_SET:
+        case NodeKind::FUNCTION:
+        case NodeKind::FUNC_CALL:
+            return -1;
+        case NodeKind::IDENTIFIER:
+        case NodeKind::INT_LITERAL:
+        case NodeKind::FLOAT_LITERAL:
+        case NodeKind::BOOLEAN_LITERAL:
+        case NodeKind::COLOUR_LITERAL:
+        case NodeKind::WIDTH:
+        case NodeKind::HEIGHT:
+        case NodeKind::PARAM:
+            return 0;
+        case NodeKind::VAR_DECL:
+        case NodeKind::BINARY_OP:
+        case NodeKind::ASSIGNMENT:
+        case NodeKind::WHILE:
+        case NodeKind::READ:
+            return 2;
+        case NodeKind::DECISION:
+        case NodeKind::WRITE:
+            return 3;
+        case NodeKind::FOR:
+            return 4;
+        case NodeKind::WRITE_BOX:
+            return 5;
+        default:
+            return 1;
+        }
+    }
+
+    // The else block and the parts of a for loop other than its condition and block
+    bool IsOptional(NodeKind kind, size_t child)
+    {
+        return (kind == NodeKind::DECISION && child == 2) || (kind == NodeKind::FOR && (child == 0 || child == 2));
+    }
+
+    // Kinds the parser puts in a block
+    bool IsStatement(NodeKind kind)
+    {
+        switch (kind)
+        {
+        case NodeKind::VAR_DECL:
+        case NodeKind::ASSIGNMENT:
+        case NodeKind::DECISION:
+        case NodeKind::RETURN:
+        case NodeKind::FUNCTION:
+        case NodeKind::WHILE:
+        case NodeKind::FOR:
+        case NodeKind::PRINT:
+        case NodeKind::DELAY:
+        case NodeKind::WRITE:
+        case NodeKind::WRITE_BOX:
+        case NodeKind::CLEAR:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Kinds the parser puts where an expression goes. Clear derives from ASTExpressionNode
+    // but is only a statement, and leaves no value for the analyzer
+    bool IsExpression(NodeKind kind)
+    {
+        switch (kind)
+        {
+        case NodeKind::IDENTIFIER:
+        case NodeKind::ARRAY_INDEX:
+        case NodeKind::ARRAY_SET:
+        case NodeKind::INT_LITERAL:
+        case NodeKind::FLOAT_LITERAL:
+        case NodeKind::BOOLEAN_LITERAL:
+        case NodeKind::COLOUR_LITERAL:
+        case NodeKind::BINARY_OP:
+        case NodeKind::NEGATE:
+        case NodeKind::NOT:
+        case NodeKind::CAST:
+        case NodeKind::WIDTH:
+        case NodeKind::HEIGHT:
+        case NodeKind::READ:
+        case NodeKind::RAND_INT:
+        case NodeKind::FUNC_CALL:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Whether the child at the given position can be of the given kind, as FlatAST::ToTree
+    // casts it to the class that position holds
+    bool IsChildKind(NodeKind parent, size_t child, NodeKind kind)
+    {
+        switch (parent)
+        {
+        case NodeKind::PROGRAM:
+            return kind == NodeKind::BLOCK;
+        case NodeKind::BLOCK:
+            return IsStatement(kind);
+        case NodeKind::VAR_DECL:
+        case NodeKind::ASSIGNMENT:
+            return child == 0 ? kind == NodeKind::IDENTIFIER || kind == NodeKind::ARRAY_INDEX : IsExpression(kind);
+        case NodeKind::DECISION:
+        case NodeKind::WHILE:
+            return child == 0 ? IsExpression(kind) : kind == NodeKind::BLOCK;
+        case NodeKind::FUNCTION:
+            return child == 0 ? kind == NodeKind::BLOCK : kind == NodeKind::PARAM;
+        case NodeKind::FOR:
+            switch (child)
+            {
+            case 0:
+                return kind == NodeKind::VAR_DECL;
+            case 1:
+                return IsExpression(kind);
+            case 2:
+                return kind == NodeKind::ASSIGNMENT;
+            default:
+                return kind == NodeKind::BLOCK;
+            }
+        default:
+            return IsExpression(kind);
+        }
+    }
+
+    // Largest type byte of each kind, 0 for kinds that have no type
+    uint8_t MaxType(NodeKind kind)
+    {
+        switch (kind)
+        {
+        case NodeKind::BINARY_OP:
+            return (uint8_t)ASTBinaryOpNode::Type::LESS_THAN_EQUAL;
+        case NodeKind::IDENTIFIER:
+        case NodeKind::ARRAY_INDEX:
+        case NodeKind::CAST:
+        case NodeKind::FUNCTION:
+        case NodeKind::PARAM:
+            return (uint8_t)Tokens::VarType::Type::COLOUR;
+        default:
+            return 0;
+        }
+    }
+}
+
+ASTProgramNode* ASTCache::Load(const std::string& path, const SourceBuffer& source, ASTContext& context)
+{
+    SourceBuffer file;
+    try
+    {
+        file = SourceBuffer::FromFile(path);
+    }
+    catch (const SourceBuffer::OpenFailedException&)
+    {
+        return nullptr;
+    }
+
+    std::string_view bytes = file.View();
+    Header header;
+    if (bytes.size() < sizeof(Header))
+        return nullptr;
+    memcpy(&header, bytes.data(), sizeof(Header));
+
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.compilerKey != CompilerKey() || header.sourceSize != source.size() ||
+        header.sourceHash != Hash(source) || header.contentHash != ContentHash(header, bytes.substr(sizeof(Header))))
+    {
+        return nullptr;
+    }
+
+    // Sections must lie inside the file after the header, aligned for their types
+    auto inFile = [&](uint64_t offset, uint64_t count, size_t size, size_t alignment)
+    {
+        return offset >= sizeof(Header) && offset % alignment == 0 && offset <= bytes.size() &&
+            count <= (bytes.size() - offset) / size;
+    };
+    if (!inFile(header.nodesOffset, header.numNodes, sizeof(FlatAST::Node), alignof(FlatAST::Node)) ||
+        !inFile(header.childrenOffset, header.numChildren, sizeof(uint32_t), alignof(uint32_t)) ||
+        !inFile(header.symbolsOffset, header.numSymbols, sizeof(Symbol), alignof(Symbol)) ||
+        !inFile(header.namesOffset, header.namesSize, 1, 1))
+    {
+        return nullptr;
+    }
+
+    // The mapping starts on a page boundary, so aligned offsets give aligned sections. They
+    // are copied into the FlatAST the tree is built from
+    auto nodes = (const FlatAST::Node*)(bytes.data() + header.nodesOffset);
+    auto children = (const uint32_t*)(bytes.data() + header.childrenOffset);
+    FlatAST ast;
+    ast.nodes.assign(nodes, nodes + header.numNodes);
+    ast.children.assign(children, children + header.numChildren);
+
+    // Names are interned again, so the symbols match the ones the lexer makes
+    std::vector<SymbolID> symbolIDs(header.numSymbols);
+    for (uint32_t i = 0; i < header.numSymbols; i++)
+    {
+        Symbol symbol;
+        memcpy(&symbol, bytes.data() + header.symbolsOffset + i * sizeof(Symbol), sizeof(Symbol));
+        if ((uint64_t)symbol.offset + symbol.length > header.namesSize)
+            return nullptr;
+
+        symbolIDs[i] = StringInterner::Global().Intern(bytes.substr(header.namesOffset + symbol.offset, symbol.length));
+    }
+
+    if (!Link(ast, symbolIDs))
+        return nullptr;
+
+    return ast.ToTree(context);
+}
+
+bool ASTCache::Save(const std::string& path, const SourceBuffer& source, ASTProgramNode& program)
+{
+    FlatAST ast = FlatAST::FromTree(program);
+
+    // Symbols are numbered in the order they are first used
+    std::unordered_map<SymbolID, uint32_t> localSymbols;
+    std::vector<Symbol> symbols;
+    std::string names;
+    for (auto& node : ast.nodes)
+    {
+        if (!HasSymbol(node.kind))
+            continue;
+
+        auto [it, inserted] = localSymbols.try_emplace(node.value, (uint32_t)symbols.size());
+        if (inserted)
+        {
+            std::string_view name = StringInterner::Global()[node.value];
+            symbols.push_back({ (uint32_t)names.size(), (uint32_t)name.size() });
+            names += name;
+        }
+        node.value = it->second;
+    }
+
+    uint64_t nodesOffset = sizeof(Header);
+    uint64_t childrenOffset = nodesOffset + ast.nodes.size() * sizeof(FlatAST::Node);
+    uint64_t symbolsOffset = childrenOffset + ast.children.size() * sizeof(uint32_t);
+    uint64_t namesOffset = symbolsOffset + symbols.size() * sizeof(Symbol);
+    if (namesOffset + names.size() > UINT32_MAX)
+        return false;
+
+    Header header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.compilerKey = CompilerKey();
+    header.sourceHash = Hash(source);
+    header.sourceSize = source.size();
+    header.numNodes = (uint32_t)ast.nodes.size();
+    header.nodesOffset = (uint32_t)nodesOffset;
+    header.numChildren = (uint32_t)ast.children.size();
+    header.childrenOffset = (uint32_t)childrenOffset;
+    header.numSymbols = (uint32_t)symbols.size();
+    header.symbolsOffset = (uint32_t)symbolsOffset;
+    header.namesSize = (uint32_t)names.size();
+    header.namesOffset = (uint32_t)namesOffset;
+
+    // The sections are put together first so they can be hashed
+    std::string content;
+    content.reserve(namesOffset + names.size() - sizeof(Header));
+    content.append((const char*)ast.nodes.data(), ast.nodes.size() * sizeof(FlatAST::Node));
+    content.append((const char*)ast.children.data(), ast.children.size() * sizeof(uint32_t));
+    content.append((const char*)symbols.data(), symbols.size() * sizeof(Symbol));
+    content.append(names);
+    header.contentHash = ContentHash(header, content);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    file.write((const char*)&header, sizeof(Header));
+    file.write(content.data(), content.size());
+    file.close();
+
+    return !file.fail();
+}
+
+uint64_t ASTCache::Hash(std::string_view text)
+{
+    // Mixes in 8 bytes at a time with a multiply and a rotate
+    constexpr uint64_t MULTIPLIER = 0x9E3779B97F4A7C15ull;
+    uint64_t hash = text.size() * MULTIPLIER;
+
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= text.size(); i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, text.data() + i, sizeof(uint64_t));
+        hash = std::rotl((hash ^ word) * MULTIPLIER, 29);
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, text.data() + i, text.size() - i);
+    hash = std::rotl((hash ^ tail) * MULTIPLIER, 29);
+
+    return hash ^ (hash >> 32);
+}
+
+uint64_t ASTCache::CompilerKey()
+{
+    static const uint64_t key = []()
+    {
+        std::ostringstream build;
+        build << VERSION << ' ' << sizeof(FlatAST::Node) << ' ' << (int)NodeKind::PARAM + 1 << ' ' << __DATE__ << ' ' << __TIME__;
+
+        // The executable changes with every build, even one that does not compile this file
+        std::filesystem::path executable = ExecutablePath();
+        std::error_code sizeError, timeError;
+        auto size = std::filesystem::file_size(executable, sizeError);
+        auto time = std::filesystem::last_write_time(executable, timeError);
+        if (!sizeError && !timeError)
+            build << ' ' << size << ' ' << time.time_since_epoch().count();
+
+        return Hash(build.str());
+    }();
+
+    return key;
+}
+
+uint64_t ASTCache::ContentHash(Header header, std::string_view content)
+{
+    // The header is hashed as bytes, which all belong to its fields
+    static_assert(std::has_unique_object_representations_v<Header>);
+    header.contentHash = 0;
+    uint64_t headerHash = Hash(std::string_view((const char*)&header, sizeof(Header)));
+
+    return headerHash ^ std::rotl(Hash(content), 32);
+}
+
+bool ASTCache::Link(FlatAST& ast, const std::vector<SymbolID>& symbolIDs)
+{
+    if (ast.nodes.empty() || ast[FlatAST::ROOT].kind != NodeKind::PROGRAM)
+        return false;
+
+    for (uint32_t i = 0; i < ast.size(); i++)
+    {
+        FlatAST::Node& node = ast.nodes[i];
+        if (node.kind > NodeKind::PARAM || node.type > MaxType(node.kind) ||
+            (uint64_t)node.firstChild + node.numChildren > ast.children.size())
+        {
+            return false;
+        }
+
+        if (HasSymbol(node.kind))
+        {
+            if (node.value >= symbolIDs.size())
+                return false;
+            node.value = symbolIDs[node.value];
+        }
+
+        int childCount = ChildCount(node.kind);
+        if ((childCount >= 0 && node.numChildren != (uint32_t)childCount) || (node.kind == NodeKind::FUNCTION && node.numChildren == 0))
+            return false;
+
+        // Array sets have a literal, and only one if it is duplicated
+        if (node.kind == NodeKind::ARRAY_SET &&
+            (node.numChildren == 0 || node.arraySize < -1 || (node.arraySize >= 0 && node.numChildren != 1)))
+        {
+            return false;
+        }
+
+        auto children = ast.Children(node);
+        for (size_t c = 0; c < children.size(); c++)
+        {
+            uint32_t child = children[c];
+            if (child == FlatAST::NONE)
+            {
+                if (!IsOptional(node.kind, c))
+                    return false;
+            }
+            else if (child <= i || child >= ast.size())
+            {
+                return false;
+            }
+            else if (!IsChildKind(node.kind, c, ast[child].kind))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include "ASTNodes.h"
+#include "ASTContext.h"
+#include "FlatAST.h"
+#include "Utils/SourceBuffer.h"
+
+// Parsed programs cached in a binary file next to their source, so unchanged files skip
+// lexing and parsing. The file holds the nodes and children of a FlatAST and the names of
+// the symbols they use, each found by its offset from the start of the file. Loading maps
+// the file, copies the sections out of it and builds the pointer tree from them. A cache
+// is only used if it was written by the same build of the compiler for a source with the
+// same hash
+class ASTCache
+{
+public:
+    // Bumped whenever the file layout changes
+    static constexpr uint32_t VERSION = 2;
+
+    static inline std::string PathFor(const std::string& sourcePath) { return sourcePath + ".past"; }
+
+    // Builds the cached program in the context, or returns nullptr if the file is missing,
+    // stale or malformed
+    static ASTProgramNode* Load(const std::string& path, const SourceBuffer& source, ASTContext& context);
+    // Returns false if the file could not be written
+    static bool Save(const std::string& path, const SourceBuffer& source, ASTProgramNode& program);
+
+    // Hash of the source the cache was written for, not meant to resist collisions made on purpose
+    static uint64_t Hash(std::string_view text);
+
+    // Identifies the compiler caches are written and read by. It covers the file layout, the
+    // size of the nodes and the number of their kinds, and the build of the compiler, found
+    // from the size and write time of its executable, so a rebuilt compiler parses again
+    static uint64_t CompilerKey();
+
+private:
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t compilerKey;
+        uint64_t sourceHash;
+        uint64_t sourceSize;
+        // Hash of the rest of the header and everything after it, so a damaged file is not used
+        uint64_t contentHash;
+        uint32_t numNodes;
+        uint32_t nodesOffset;
+        uint32_t numChildren;
+        uint32_t childrenOffset;
+        // Offset and length of each name in the name bytes
+        uint32_t numSymbols;
+        uint32_t symbolsOffset;
+        uint32_t namesSize;
+        uint32_t namesOffset;
+    };
+
+    struct Symbol
+    {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    static constexpr char MAGIC[4] = { 'P', 'A', 'S', 'T' };
+
+    static uint64_t ContentHash(Header header, std::string_view content);
+
+    // Replaces the symbols numbered by the file with the given IDs. Also checks that every
+    // child is in range and comes after its parent, so the tree has no cycles, that each
+    // kind has the number and kinds of children FlatAST::ToTree expects, and that type
+    // bytes hold a value of their enum
+    static bool Link(FlatAST& ast, const std::vector<SymbolID>& symbolIDs);
+};
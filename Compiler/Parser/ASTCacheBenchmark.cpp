@@ -0,0 +1,139 @@
+// Measures a cold parse of each program against loading its AST from a cache, and checks
+// that the loaded AST is the one the parse built. Besides the given files, it runs on a
+// generated program with many functions, the size of file the cache is meant for. The
+// caches are written to the temporary directory. Not part of the compiler's build. From
+// the Compiler directory:
+//   g++ -std=c++20 -O2 -I. Parser/ASTCacheBenchmark.cpp Lexer/Lexer.cpp Parser/Parser.cpp Parser/ASTNodes.cpp
+//       Parser/FlatAST.cpp Parser/ASTCache.cpp Utils/SourceBuffer.cpp Utils/StackGuard.cpp -lpthread -o ASTCacheBenchmark
+//   ./ASTCacheBenchmark src/*.parl
+#include "Parser.h"
+#include "ASTCache.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Functions of the generated program, about 1MB of source
+    constexpr int GENERATED_FUNCTIONS = 2000;
+
+    std::string GenerateProgram()
+    {
+        std::ostringstream program;
+        for (int i = 0; i < GENERATED_FUNCTIONS; i++)
+        {
+            program << "fun helper" << i << "(x:int, y:float) -> int {\n";
+            program << "    let total:int = x * " << i << " + (y as int);\n";
+            program << "    let colours:colour[] = [#ff0000, #00ff00, #0000ff, #ffffff];\n";
+            program << "    for (let j:int = 0; j < 8; j = j + 1) {\n";
+            program << "        if ((total % 2 == 0) and (j > 2)) {\n";
+            program << "            total = total - j;\n";
+            program << "        } else {\n";
+            program << "            total = total * 3 + 1;\n";
+            program << "        }\n";
+            program << "        __write j, total % __height, colours[j % 4];\n";
+            program << "    }\n";
+            program << "    while (total > 100) {\n";
+            program << "        total = total - __random_int 10;\n";
+            program << "    }\n";
+            program << "    return total;\n";
+            program << "}\n\n";
+        }
+        program << "__print helper0(1, 2.5);\n";
+        return program.str();
+    }
+
+    bool SameNodes(const FlatAST& a, const FlatAST& b)
+    {
+        if (a.size() != b.size() || a.children != b.children)
+            return false;
+
+        for (uint32_t i = 0; i < a.size(); i++)
+        {
+            const FlatAST::Node& x = a[i];
+            const FlatAST::Node& y = b[i];
+            if (x.kind != y.kind || x.type != y.type || x.sourceIndex != y.sourceIndex || x.value != y.value ||
+                x.arraySize != y.arraySize || x.firstChild != y.firstChild || x.numChildren != y.numChildren)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Best of several runs in milliseconds, with enough runs to take about half a second
+    template<typename F>
+    double BestMs(F&& f)
+    {
+        double best = 1e30;
+        double total = 0.0;
+        for (int run = 0; run < 5 || (total < 500.0 && run < 10000); run++)
+        {
+            auto start = Clock::now();
+            f();
+            std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+            best = std::min(best, elapsed.count());
+            total += elapsed.count();
+        }
+        return best;
+    }
+
+    // Returns false if the loaded AST is missing or differs from the parsed one
+    bool Measure(const std::string& name, const SourceBuffer& source, const std::string& cachePath)
+    {
+        Parser parser;
+        ASTContext parsedContext;
+        ASTProgramNode* parsed = parser.Parse(source, parsedContext);
+        if (!ASTCache::Save(cachePath, source, *parsed))
+        {
+            std::cerr << name << ": could not write " << cachePath << "\n";
+            return false;
+        }
+
+        ASTContext loadedContext;
+        ASTProgramNode* loaded = ASTCache::Load(cachePath, source, loadedContext);
+        if (!loaded || !SameNodes(FlatAST::FromTree(*parsed), FlatAST::FromTree(*loaded)))
+        {
+            std::cerr << name << ": the cached AST differs from the parsed one\n";
+            return false;
+        }
+
+        double parseMs = BestMs([&]()
+        {
+            ASTContext context;
+            parser.Parse(source, context);
+        });
+        double loadMs = BestMs([&]()
+        {
+            ASTContext context;
+            ASTCache::Load(cachePath, source, context);
+        });
+
+        std::cout << name << " (" << source.size() << " bytes, " << FlatAST::FromTree(*parsed).size() << " nodes): parse "
+            << parseMs << " ms, cache load " << loadMs << " ms\n";
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string cachePath = (std::filesystem::temp_directory_path() / "ASTCacheBenchmark.past").string();
+    bool passed = true;
+
+    for (int i = 1; i < argc; i++)
+    {
+        SourceBuffer source = SourceBuffer::FromFile(argv[i]);
+        passed &= Measure(argv[i], source, cachePath);
+    }
+
+    std::string generated = GenerateProgram();
+    passed &= Measure("generated program", SourceBuffer(generated), cachePath);
+
+    std::filesystem::remove(cachePath);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <memory_resource>
+#include <utility>
+#include <new>
+#include <vector>
+#include <memory>
+
+// Owns the nodes of an AST. Nodes are bump allocated from large blocks that are
+// all released together when the context is destroyed, without visiting the tree
+class ASTContext
+{
+public:
+    ASTContext() = default;
+    ASTContext(const ASTContext&) = delete;
+    ASTContext& operator=(const ASTContext&) = delete;
+
+    // The node lives until the context is destroyed and its destructor is never run
+    template<typename T, typename ... Args>
+    inline T* Create(Args&& ... args)
+    {
+        void* memory = arena.allocate(sizeof(T), alignof(T));
+        return new (memory) T(std::forward<Args>(args)...);
+    }
+
+    // For containers inside nodes, so they are released with the nodes
+    inline std::pmr::memory_resource* Resource() { return &arena; }
+
+    // Contexts are not thread safe, so another thread can build part of the AST in a
+    // child context instead. The child is released together with this context
+    inline ASTContext& CreateChild()
+    {
+        return *children.emplace_back(std::make_unique<ASTContext>());
+    }
+
+private:
+    static constexpr size_t INITIAL_BLOCK_SIZE = 64 * 1024;
+
+    std::pmr::monotonic_buffer_resource arena{ INITIAL_BLOCK_SIZE };
+    std::vector<std::unique_ptr<ASTContext>> children;
+};
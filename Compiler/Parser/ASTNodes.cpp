@@ -1,52 +1,58 @@
 #include "ASTNodes.h"
+#include "Parser.h"
 
-ASTProgramNode::ASTProgramNode(std::unique_ptr<ASTBlockNode> blockNode)
-    : blockNode(std::move(blockNode))
+ASTProgramNode::ASTProgramNode(ASTBlockNode* blockNode)
+    : ASTNode(NodeKind::PROGRAM), blockNode(blockNode)
 {
 }
 
-ASTBlockNode::ASTBlockNode()
-    : statements()
+ASTBlockNode::ASTBlockNode(std::pmr::memory_resource* resource)
+    : ASTNode(NodeKind::BLOCK), statements(resource)
 {
 }
 
-ASTIdentifierNode::ASTIdentifierNode(const std::string& name, Tokens::VarType::Type type, int arraySize)
-    : name(name), type(type), arraySize(arraySize)
+ASTIdentifierNode::ASTIdentifierNode(SymbolID name, Tokens::VarType::Type type, int arraySize)
+    : ASTExpressionNode(NodeKind::IDENTIFIER), name(name), type(type), arraySize(arraySize)
 {
 }
 
-ASTVarDeclNode::ASTVarDeclNode(std::unique_ptr<ASTIdentifierNode> identifier, std::unique_ptr<ASTExpressionNode> value)
-    : identifier(std::move(identifier)), value(std::move(value))
+ASTIdentifierNode::ASTIdentifierNode(NodeKind kind, SymbolID name)
+    : ASTExpressionNode(kind), name(name)
+{
+}
+
+ASTVarDeclNode::ASTVarDeclNode(ASTIdentifierNode* identifier, ASTExpressionNode* value)
+    : ASTNode(NodeKind::VAR_DECL), identifier(identifier), value(value)
 {
 }
 
 ASTIntLiteralNode::ASTIntLiteralNode(int value)
-    : value(value)
+    : ASTExpressionNode(NodeKind::INT_LITERAL), value(value)
 {
 }
 
 ASTFloatLiteralNode::ASTFloatLiteralNode(float value)
-    : value(value)
+    : ASTExpressionNode(NodeKind::FLOAT_LITERAL), value(value)
 {
 }
 
 ASTBooleanLiteralNode::ASTBooleanLiteralNode(bool value)
-    : value(value)
+    : ASTExpressionNode(NodeKind::BOOLEAN_LITERAL), value(value)
 {
 }
 
 ASTColourLiteralNode::ASTColourLiteralNode(int value)
-    : value(value)
+    : ASTExpressionNode(NodeKind::COLOUR_LITERAL), value(value)
 {
 }
 
-ASTBinaryOpNode::ASTBinaryOpNode(Type type, std::unique_ptr<ASTExpressionNode> left, std::unique_ptr<ASTExpressionNode> right)
-    : type(type), left(std::move(left)), right(std::move(right))
+ASTBinaryOpNode::ASTBinaryOpNode(Type type, ASTExpressionNode* left, ASTExpressionNode* right)
+    : ASTExpressionNode(NodeKind::BINARY_OP), type(type), left(left), right(right)
 {
 }
 
-ASTBinaryOpNode::ASTBinaryOpNode(Tokens::AdditiveOp::Type type, std::unique_ptr<ASTExpressionNode> left, std::unique_ptr<ASTExpressionNode> right)
-    : type(Type::ADD), left(std::move(left)), right(std::move(right))
+ASTBinaryOpNode::ASTBinaryOpNode(Tokens::AdditiveOp::Type type, ASTExpressionNode* left, ASTExpressionNode* right)
+    : ASTExpressionNode(NodeKind::BINARY_OP), type(Type::ADD), left(left), right(right)
 {
     switch (type)
     {
@@ -62,8 +68,8 @@ ASTBinaryOpNode::ASTBinaryOpNode(Tokens::AdditiveOp::Type type, std::unique_ptr<
     }
 }
 
-ASTBinaryOpNode::ASTBinaryOpNode(Tokens::MultiplicativeOp::Type type, std::unique_ptr<ASTExpressionNode> left, std::unique_ptr<ASTExpressionNode> right)
-    : type(Type::ADD), left(std::move(left)), right(std::move(right))
+ASTBinaryOpNode::ASTBinaryOpNode(Tokens::MultiplicativeOp::Type type, ASTExpressionNode* left, ASTExpressionNode* right)
+    : ASTExpressionNode(NodeKind::BINARY_OP), type(Type::ADD), left(left), right(right)
 {
     switch (type)
     {
@@ -82,8 +88,8 @@ ASTBinaryOpNode::ASTBinaryOpNode(Tokens::MultiplicativeOp::Type type, std::uniqu
     }
 }
 
-ASTBinaryOpNode::ASTBinaryOpNode(Tokens::RelationalOp::Type type, std::unique_ptr<ASTExpressionNode> left, std::unique_ptr<ASTExpressionNode> right)
-    : type(Type::ADD), left(std::move(left)), right(std::move(right))
+ASTBinaryOpNode::ASTBinaryOpNode(Tokens::RelationalOp::Type type, ASTExpressionNode* left, ASTExpressionNode* right)
+    : ASTExpressionNode(NodeKind::BINARY_OP), type(Type::ADD), left(left), right(right)
 {
     switch (type)
     {
@@ -108,108 +114,120 @@ ASTBinaryOpNode::ASTBinaryOpNode(Tokens::RelationalOp::Type type, std::unique_pt
     }
 }
 
-ASTNegateNode::ASTNegateNode(std::unique_ptr<ASTExpressionNode> expr)
-    : expr(std::move(expr))
+ASTNegateNode::ASTNegateNode(ASTExpressionNode* expr)
+    : ASTExpressionNode(NodeKind::NEGATE), expr(expr)
+{
+}
+
+ASTNotNode::ASTNotNode(ASTExpressionNode* expr)
+    : ASTExpressionNode(NodeKind::NOT), expr(expr)
+{
+}
+
+ASTAssignmentNode::ASTAssignmentNode(ASTIdentifierNode* identifier, ASTExpressionNode* expr)
+    : ASTNode(NodeKind::ASSIGNMENT), identifier(identifier), expr(expr)
 {
 }
 
-ASTNotNode::ASTNotNode(std::unique_ptr<ASTExpressionNode> expr)
-    : expr(std::move(expr))
+ASTDecisionNode::ASTDecisionNode(ASTExpressionNode* expr, ASTBlockNode* trueStatement, ASTBlockNode* falseStatement)
+    : ASTNode(NodeKind::DECISION), expr(expr), trueStatement(trueStatement), falseStatement(falseStatement)
 {
 }
 
-ASTAssignmentNode::ASTAssignmentNode(Scope<ASTIdentifierNode> identifier, Scope<ASTExpressionNode> expr)
-    : identifier(std::move(identifier)), expr(std::move(expr))
+ASTReturnNode::ASTReturnNode(ASTExpressionNode* expr)
+    : ASTNode(NodeKind::RETURN), expr(expr)
 {
 }
 
-ASTDecisionNode::ASTDecisionNode(Scope<ASTExpressionNode> expr, Scope<ASTBlockNode> trueStatement, Scope<ASTBlockNode> falseStatement)
-    : expr(std::move(expr)), trueStatement(std::move(trueStatement)), falseStatement(std::move(falseStatement))
+ASTFunctionNode::ASTFunctionNode(SymbolID name, ParamList params, Tokens::VarType::Type returnType, int arraySize, ASTBlockNode* blockNode)
+    : ASTNode(NodeKind::FUNCTION), name(name), params(std::move(params)), returnType(returnType), returnSize(arraySize), blockNode(blockNode)
 {
 }
 
-ASTReturnNode::ASTReturnNode(Scope<ASTExpressionNode> expr)
-    : expr(std::move(expr))
+ASTBlockNode* ASTFunctionNode::Body()
 {
+    if (!blockNode)
+        blockNode = bodyParser->ParseFunctionBody(bodyToken);
+    return blockNode;
 }
 
-ASTFunctionNode::ASTFunctionNode(const std::string& name, const std::vector<Param>& params, Tokens::VarType::Type returnType, int arraySize, Scope<ASTBlockNode> blockNode)
-    : name(name), params(params), returnType(returnType), returnSize(arraySize), blockNode(std::move(blockNode))
+ASTWhileNode::ASTWhileNode(ASTExpressionNode* expr, ASTBlockNode* blockNode)
+    : ASTNode(NodeKind::WHILE), expr(expr), blockNode(blockNode)
 {
 }
 
-ASTWhileNode::ASTWhileNode(Scope<ASTExpressionNode> expr, Scope<ASTBlockNode> blockNode)
-    : expr(std::move(expr)), blockNode(std::move(blockNode))
+ASTForNode::ASTForNode(ASTVarDeclNode* variableDecl, ASTExpressionNode* expr, ASTAssignmentNode* assignment, ASTBlockNode* blockNode)
+    : ASTNode(NodeKind::FOR), variableDecl(variableDecl), expr(expr), assignment(assignment), blockNode(blockNode)
 {
 }
 
-ASTForNode::ASTForNode(Scope<ASTVarDeclNode> variableDecl, Scope<ASTExpressionNode> expr, Scope<ASTAssignmentNode> assignment, Scope<ASTBlockNode> blockNode)
-    : variableDecl(std::move(variableDecl)), expr(std::move(expr)), assignment(std::move(assignment)), blockNode(std::move(blockNode))
+ASTPrintNode::ASTPrintNode(ASTExpressionNode* expr)
+    : ASTNode(NodeKind::PRINT), expr(expr)
 {
 }
 
-ASTPrintNode::ASTPrintNode(Scope<ASTExpressionNode> expr)
-    : expr(std::move(expr))
+ASTDelayNode::ASTDelayNode(ASTExpressionNode* delayExpr)
+    : ASTNode(NodeKind::DELAY), delayExpr(delayExpr)
 {
 }
 
-ASTDelayNode::ASTDelayNode(Scope<ASTExpressionNode> delayExpr)
-    : delayExpr(std::move(delayExpr))
+ASTWriteNode::ASTWriteNode(ASTExpressionNode* x, ASTExpressionNode* y, ASTExpressionNode* colour)
+    : ASTNode(NodeKind::WRITE), x(x), y(y), colour(colour)
 {
 }
 
-ASTWriteNode::ASTWriteNode(Scope<ASTExpressionNode> x, Scope<ASTExpressionNode> y, Scope<ASTExpressionNode> colour)
-    : x(std::move(x)), y(std::move(y)), colour(std::move(colour))
+ASTWriteBoxNode::ASTWriteBoxNode(ASTExpressionNode* x, ASTExpressionNode* y, ASTExpressionNode* w, ASTExpressionNode* h, ASTExpressionNode* colour)
+    : ASTNode(NodeKind::WRITE_BOX), x(x), y(y), w(w), h(h), colour(colour)
 {
 }
 
-ASTWriteBoxNode::ASTWriteBoxNode(Scope<ASTExpressionNode> x, Scope<ASTExpressionNode> y, Scope<ASTExpressionNode> w, Scope<ASTExpressionNode> h, Scope<ASTExpressionNode> colour)
-    : x(std::move(x)), y(std::move(y)), w(std::move(w)), h(std::move(h)), colour(std::move(colour))
+ASTReadNode::ASTReadNode(ASTExpressionNode* x, ASTExpressionNode* y)
+    : ASTExpressionNode(NodeKind::READ), x(x), y(y)
 {
 }
 
-ASTReadNode::ASTReadNode(Scope<ASTExpressionNode> x, Scope<ASTExpressionNode> y)
-    : x(std::move(x)), y(std::move(y))
+ASTRandIntNode::ASTRandIntNode(ASTExpressionNode* max)
+    : ASTExpressionNode(NodeKind::RAND_INT), max(max)
 {
 }
 
-ASTRandIntNode::ASTRandIntNode(Scope<ASTExpressionNode> max)
-    : max(std::move(max))
+ASTFuncCallNode::ASTFuncCallNode(SymbolID funcName, std::pmr::memory_resource* resource)
+    : ASTExpressionNode(NodeKind::FUNC_CALL), funcName(funcName), args(resource)
 {
 }
 
-ASTFuncCallNode::ASTFuncCallNode(const std::string& funcName)
-    : funcName(funcName), args()
+void ASTFuncCallNode::AddArg(ASTExpressionNode* arg)
 {
+    args.push_back(arg);
 }
 
-void ASTFuncCallNode::AddArg(Scope<ASTExpressionNode> arg)
+ASTCastNode::ASTCastNode(Tokens::VarType::Type castType, ASTExpressionNode* expr)
+    : ASTExpressionNode(NodeKind::CAST), castType(castType), expr(expr)
 {
-    args.push_back(std::move(arg));
 }
 
-ASTCastNode::ASTCastNode(Tokens::VarType::Type castType, std::unique_ptr<ASTExpressionNode> expr)
-    : castType(castType), expr(std::move(expr))
+ASTArraySetNode::ASTArraySetNode(std::pmr::memory_resource* resource)
+    : ASTExpressionNode(NodeKind::ARRAY_SET), literals(resource)
 {
 }
 
-ASTArraySetNode::ASTArraySetNode(Scope<ASTExpressionNode> lit, int duplication)
-    : duplication(duplication)
+ASTArraySetNode::ASTArraySetNode(std::pmr::memory_resource* resource, ASTExpressionNode* lit, int duplication)
+    : ASTExpressionNode(NodeKind::ARRAY_SET), literals(resource), duplication(duplication)
 {
-    literals.push_back(std::move(lit));
+    literals.push_back(lit);
 }
 
-void ASTArraySetNode::AddLiterial(Scope<ASTExpressionNode> lit)
+void ASTArraySetNode::AddLiterial(ASTExpressionNode* lit)
 {
-    literals.push_back(std::move(lit));
+    literals.push_back(lit);
 }
 
-ASTArrayIndexNode::ASTArrayIndexNode(const std::string& name, Scope<ASTExpressionNode> index)
-    : ASTIdentifierNode(name), name(name), index(std::move(index))
+ASTArrayIndexNode::ASTArrayIndexNode(SymbolID name, ASTExpressionNode* index)
+    : ASTIdentifierNode(NodeKind::ARRAY_INDEX, name), name(name), index(index)
 {
 }
 
-ASTClearNode::ASTClearNode(std::unique_ptr<ASTExpressionNode> expr)
-    : expr(std::move(expr))
+ASTClearNode::ASTClearNode(ASTExpressionNode* expr)
+    : ASTExpressionNode(NodeKind::CLEAR), expr(expr)
 {
 }
@@ -1,59 +1,169 @@
 #pragma once
 #include "../Lexer/Tokens.h"
 #include "../Utils/Visitor.h"
+#include "../Utils/StackGuard.h"
+#include "../Utils/SmallVector.h"
 
 #include <vector>
 #include <memory>
+#include <memory_resource>
 #include <string>
+#include <type_traits>
+
+
+enum class NodeKind : uint8_t
+{
+    PROGRAM,
+    BLOCK,
+    IDENTIFIER,
+    ARRAY_INDEX,
+    ARRAY_SET,
+    INT_LITERAL,
+    FLOAT_LITERAL,
+    BOOLEAN_LITERAL,
+    COLOUR_LITERAL,
+    VAR_DECL,
+    BINARY_OP,
+    NEGATE,
+    NOT,
+    CAST,
+    ASSIGNMENT,
+    DECISION,
+    RETURN,
+    FUNCTION,
+    WHILE,
+    FOR,
+    PRINT,
+    DELAY,
+    WRITE,
+    WRITE_BOX,
+    WIDTH,
+    HEIGHT,
+    READ,
+    CLEAR,
+    RAND_INT,
+    FUNC_CALL,
+    // Function parameter, only a node of its own in the FlatAST
+    PARAM,
+};
 
-
+class Parser;
+
+// Node class of every kind, except PARAM which only exists in the FlatAST
+#define AST_NODES \
+    X(PROGRAM, ASTProgramNode) \
+    X(BLOCK, ASTBlockNode) \
+    X(IDENTIFIER, ASTIdentifierNode) \
+    X(ARRAY_INDEX, ASTArrayIndexNode) \
+    X(ARRAY_SET, ASTArraySetNode) \
+    X(INT_LITERAL, ASTIntLiteralNode) \
+    X(FLOAT_LITERAL, ASTFloatLiteralNode) \
+    X(BOOLEAN_LITERAL, ASTBooleanLiteralNode) \
+    X(COLOUR_LITERAL, ASTColourLiteralNode) \
+    X(VAR_DECL, ASTVarDeclNode) \
+    X(BINARY_OP, ASTBinaryOpNode) \
+    X(NEGATE, ASTNegateNode) \
+    X(NOT, ASTNotNode) \
+    X(CAST, ASTCastNode) \
+    X(ASSIGNMENT, ASTAssignmentNode) \
+    X(DECISION, ASTDecisionNode) \
+    X(RETURN, ASTReturnNode) \
+    X(FUNCTION, ASTFunctionNode) \
+    X(WHILE, ASTWhileNode) \
+    X(FOR, ASTForNode) \
+    X(PRINT, ASTPrintNode) \
+    X(DELAY, ASTDelayNode) \
+    X(WRITE, ASTWriteNode) \
+    X(WRITE_BOX, ASTWriteBoxNode) \
+    X(WIDTH, ASTWidthNode) \
+    X(HEIGHT, ASTHeightNode) \
+    X(READ, ASTReadNode) \
+    X(CLEAR, ASTClearNode) \
+    X(RAND_INT, ASTRandIntNode) \
+    X(FUNC_CALL, ASTFuncCallNode)
+
+template<typename T>
+struct NodeKindOf;
+
+#define X(name, type) template<> struct NodeKindOf<type> { static constexpr NodeKind value = NodeKind::name; };
+AST_NODES
+#undef X
+
+// Whether a node of the given kind is a T. Only identifiers are more than one kind, as
+// array indices derive from them
+template<typename T>
+constexpr bool IsKind(NodeKind kind)
+{
+    if constexpr (std::is_same_v<T, ASTIdentifierNode>)
+        return kind == NodeKind::IDENTIFIER || kind == NodeKind::ARRAY_INDEX;
+    else
+        return kind == NodeKindOf<T>::value;
+}
+
+// Nodes are allocated from an ASTContext and hold non-owning pointers to their children.
+// Their destructors are never run, so any memory they use must also come from the context
 class ASTNode
 {
 public:
-    virtual ~ASTNode() = default;
+    ASTNode(NodeKind kind)
+        : kind(kind)
+    {}
+
+    // Calls the visitor's visit overload for the node's kind. Nodes have no vtable, so
+    // visitors that are final classes have their visit called directly
+    template<typename V>
+    void accept(V& visitor);
 
-    virtual void accept(Visitor& visitor) = 0;
+    // The node as a T, or nullptr if it is a node of another kind
+    template<typename T>
+    inline T* As() { return IsKind<T>(kind) ? static_cast<T*>(this) : nullptr; }
+public:
+    const NodeKind kind;
+    // Index in the program of the node's first character, used for error messages
+    uint32_t sourceIndex = 0;
 };
 
 class ASTBlockNode : public ASTNode
 {
 public:
-    ASTBlockNode();
+    ASTBlockNode(std::pmr::memory_resource* resource);
 
-    inline void AddStatement(std::unique_ptr<ASTNode> statement)
+    inline void AddStatement(ASTNode* statement)
     {
-        statements.push_back(std::move(statement));
+        statements.push_back(statement);
     }
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
 public:
-    std::vector<std::unique_ptr<ASTNode>> statements;
+    // Most blocks are if and loop bodies of a few statements
+    SmallVector<ASTNode*, 4> statements;
 };
 
 class ASTProgramNode : public ASTNode
 {
 public:
-    ASTProgramNode(std::unique_ptr<ASTBlockNode> blockNode);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTProgramNode(ASTBlockNode* blockNode);
 public:
-    std::unique_ptr<ASTBlockNode> blockNode;
+    ASTBlockNode* blockNode;
 };
 
 class ASTExpressionNode : public ASTNode
 {
+public:
+    ASTExpressionNode(NodeKind kind)
+        : ASTNode(kind)
+    {}
 };
 
 class ASTIdentifierNode : public ASTExpressionNode
 {
 public:
-    ASTIdentifierNode(const std::string& name, Tokens::VarType::Type type = Tokens::VarType::Type::UNKNOWN, int arraySize = -1);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTIdentifierNode(SymbolID name, Tokens::VarType::Type type = Tokens::VarType::Type::UNKNOWN, int arraySize = -1);
 
     inline bool IsArray() const { return arraySize > 0; }
+protected:
+    // For array indices
+    ASTIdentifierNode(NodeKind kind, SymbolID name);
 public:
-    std::string name;
+    SymbolID name;
     Tokens::VarType::Type type = Tokens::VarType::Type::UNKNOWN;
     int arraySize = -1;
 };
@@ -61,25 +171,22 @@ public:
 class ASTArrayIndexNode : public ASTIdentifierNode
 {
 public:
-    ASTArrayIndexNode(const std::string& name, Scope<ASTExpressionNode> index);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTArrayIndexNode(SymbolID name, ASTExpressionNode* index);
 public:
-    std::string name;
-    Scope<ASTExpressionNode> index;
+    SymbolID name;
+    ASTExpressionNode* index;
 };
 
 class ASTArraySetNode : public ASTExpressionNode
 {
 public:
-    ASTArraySetNode() = default;
-    ASTArraySetNode(Scope<ASTExpressionNode> lit, int duplication);
-
-    void AddLiterial(Scope<ASTExpressionNode> lit);
+    ASTArraySetNode(std::pmr::memory_resource* resource);
+    ASTArraySetNode(std::pmr::memory_resource* resource, ASTExpressionNode* lit, int duplication);
 
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    void AddLiterial(ASTExpressionNode* lit);
 public:
-    std::vector<Scope<ASTExpressionNode>> literals;
+    // Usually a single literal repeated by duplication
+    SmallVector<ASTExpressionNode*, 1> literals;
     // Number of times to duplicate a number
     int duplication = -1;
 };
@@ -88,8 +195,6 @@ class ASTIntLiteralNode : public ASTExpressionNode
 {
 public:
     ASTIntLiteralNode(int value);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
 public:
     int value;
 };
@@ -98,8 +203,6 @@ class ASTFloatLiteralNode : public ASTExpressionNode
 {
 public:
     ASTFloatLiteralNode(float value);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
 public:
     float value;
 };
@@ -108,8 +211,6 @@ class ASTBooleanLiteralNode : public ASTExpressionNode
 {
 public:
     ASTBooleanLiteralNode(bool value);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
 public:
     bool value;
 };
@@ -118,8 +219,6 @@ class ASTColourLiteralNode : public ASTExpressionNode
 {
 public:
     ASTColourLiteralNode(int value);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
 public:
     int value;
 };
@@ -127,12 +226,10 @@ public:
 class ASTVarDeclNode : public ASTNode
 {
 public:
-    ASTVarDeclNode(std::unique_ptr<ASTIdentifierNode> identifier, std::unique_ptr<ASTExpressionNode> value);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTVarDeclNode(ASTIdentifierNode* identifier, ASTExpressionNode* value);
 public:
-    std::unique_ptr<ASTIdentifierNode> identifier;
-    std::unique_ptr<ASTExpressionNode> value;
+    ASTIdentifierNode* identifier;
+    ASTExpressionNode* value;
 };
 
 class ASTBinaryOpNode : public ASTExpressionNode
@@ -157,80 +254,66 @@ public:
         LESS_THAN_EQUAL,
     };
 public:
-    ASTBinaryOpNode(Type type, std::unique_ptr<ASTExpressionNode> left, std::unique_ptr<ASTExpressionNode> right);
-    ASTBinaryOpNode(Tokens::AdditiveOp::Type type, std::unique_ptr<ASTExpressionNode> left, std::unique_ptr<ASTExpressionNode> right);
-    ASTBinaryOpNode(Tokens::MultiplicativeOp::Type type, std::unique_ptr<ASTExpressionNode> left, std::unique_ptr<ASTExpressionNode> right);
-    ASTBinaryOpNode(Tokens::RelationalOp::Type type, std::unique_ptr<ASTExpressionNode> left, std::unique_ptr<ASTExpressionNode> right);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
+    ASTBinaryOpNode(Type type, ASTExpressionNode* left, ASTExpressionNode* right);
+    ASTBinaryOpNode(Tokens::AdditiveOp::Type type, ASTExpressionNode* left, ASTExpressionNode* right);
+    ASTBinaryOpNode(Tokens::MultiplicativeOp::Type type, ASTExpressionNode* left, ASTExpressionNode* right);
+    ASTBinaryOpNode(Tokens::RelationalOp::Type type, ASTExpressionNode* left, ASTExpressionNode* right);
 public:
     Type type = Type::ADD;
-    std::unique_ptr<ASTExpressionNode> left;
-    std::unique_ptr<ASTExpressionNode> right;
+    ASTExpressionNode* left;
+    ASTExpressionNode* right;
 };
 
 class ASTNegateNode : public ASTExpressionNode
 {
 public:
-    ASTNegateNode(std::unique_ptr<ASTExpressionNode> expr);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTNegateNode(ASTExpressionNode* expr);
 public:
-    std::unique_ptr<ASTExpressionNode> expr;
+    ASTExpressionNode* expr;
 };
 
 class ASTNotNode : public ASTExpressionNode
 {
 public:
-    ASTNotNode(std::unique_ptr<ASTExpressionNode> expr);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTNotNode(ASTExpressionNode* expr);
 public:
-    std::unique_ptr<ASTExpressionNode> expr;
+    ASTExpressionNode* expr;
 };
 
 class ASTCastNode : public ASTExpressionNode
 {
 public:
-    ASTCastNode(Tokens::VarType::Type castType, std::unique_ptr<ASTExpressionNode> expr);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTCastNode(Tokens::VarType::Type castType, ASTExpressionNode* expr);
 public:
     Tokens::VarType::Type castType;
-    std::unique_ptr<ASTExpressionNode> expr;
+    ASTExpressionNode* expr;
 };
 
 class ASTAssignmentNode : public ASTNode
 {
 public:
-    ASTAssignmentNode(Scope<ASTIdentifierNode> identifier, Scope<ASTExpressionNode> expr);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTAssignmentNode(ASTIdentifierNode* identifier, ASTExpressionNode* expr);
 public:
-    Scope<ASTIdentifierNode> identifier;
-    Scope<ASTExpressionNode> expr;
+    ASTIdentifierNode* identifier;
+    ASTExpressionNode* expr;
 };
 
 class ASTDecisionNode : public ASTNode
 {
 public:
-    ASTDecisionNode(Scope<ASTExpressionNode> expr, Scope<ASTBlockNode> trueStatement, Scope<ASTBlockNode> falseStatement = nullptr);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTDecisionNode(ASTExpressionNode* expr, ASTBlockNode* trueStatement, ASTBlockNode* falseStatement = nullptr);
 public:
-    Scope<ASTExpressionNode> expr;
-    Scope<ASTBlockNode> trueStatement;
-    Scope<ASTBlockNode> falseStatement;
+    ASTExpressionNode* expr;
+    ASTBlockNode* trueStatement;
+    ASTBlockNode* falseStatement;
 };
 
 class ASTReturnNode : public ASTNode
 {
 public:
-    ASTReturnNode(Scope<ASTExpressionNode> expr);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTReturnNode(ASTExpressionNode* expr);
 public:
-    Scope<ASTExpressionNode> expr;
+    ASTExpressionNode* expr;
 };
 
 class ASTFunctionNode : public ASTNode
@@ -239,7 +322,7 @@ public:
     struct Param
     {
     public:
-        Param(const std::string& name, Tokens::VarType::Type type, int arraySize = -1)
+        Param(SymbolID name, Tokens::VarType::Type type, int arraySize = -1)
             : Name(name), Type(type), ArraySize(arraySize)
         {}
 
@@ -247,148 +330,153 @@ public:
 
         bool IsArray() const { return ArraySize > 0; }
     public:
-        std::string Name;
+        SymbolID Name;
         Tokens::VarType::Type Type;
         int ArraySize = -1;
     };
+
+    using ParamList = SmallVector<Param, 3>;
 public:
-    ASTFunctionNode(const std::string& name, const std::vector<Param>& params, Tokens::VarType::Type returnType, int arraySize, Scope<ASTBlockNode> blockNode);
+    ASTFunctionNode(SymbolID name, ParamList params, Tokens::VarType::Type returnType, int arraySize, ASTBlockNode* blockNode);
 
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    // The function's block, which is parsed here on first use if a lazy parse skipped it
+    ASTBlockNode* Body();
+    inline bool IsParsed() const { return blockNode != nullptr; }
 public:
-    std::string name;
-    std::vector<Param> params;
+    SymbolID name;
+    ParamList params;
     Tokens::VarType::Type returnType;
     int returnSize = -1;
-    Scope<ASTBlockNode> blockNode;
+    ASTBlockNode* blockNode;
+    // Parser that skipped the block and the token the block starts at
+    Parser* bodyParser = nullptr;
+    int bodyToken = 0;
 };
 
 class ASTWhileNode : public ASTNode
 {
 public:
-    ASTWhileNode(Scope<ASTExpressionNode> expr, Scope<ASTBlockNode> blockNode);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTWhileNode(ASTExpressionNode* expr, ASTBlockNode* blockNode);
 public:
-    Scope<ASTExpressionNode> expr;
-    Scope<ASTBlockNode> blockNode;
+    ASTExpressionNode* expr;
+    ASTBlockNode* blockNode;
 };
 
 class ASTForNode : public ASTNode
 {
 public:
-    ASTForNode(Scope<ASTVarDeclNode> variableDecl, Scope<ASTExpressionNode> expr, Scope<ASTAssignmentNode> assignment, Scope<ASTBlockNode> blockNode);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTForNode(ASTVarDeclNode* variableDecl, ASTExpressionNode* expr, ASTAssignmentNode* assignment, ASTBlockNode* blockNode);
 public:
-    Scope<ASTVarDeclNode> variableDecl;
-    Scope<ASTExpressionNode> expr;
-    Scope<ASTAssignmentNode> assignment;
-    Scope<ASTBlockNode> blockNode;
+    ASTVarDeclNode* variableDecl;
+    ASTExpressionNode* expr;
+    ASTAssignmentNode* assignment;
+    ASTBlockNode* blockNode;
 };
 
 class ASTPrintNode : public ASTNode
 {
 public:
-    ASTPrintNode(Scope<ASTExpressionNode> expr);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTPrintNode(ASTExpressionNode* expr);
 public:
-    Scope<ASTExpressionNode> expr;
+    ASTExpressionNode* expr;
 };
 
 class ASTDelayNode : public ASTNode
 {
 public:
-    ASTDelayNode(Scope<ASTExpressionNode> delayExpr);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTDelayNode(ASTExpressionNode* delayExpr);
 public:
-    Scope<ASTExpressionNode> delayExpr;
+    ASTExpressionNode* delayExpr;
 };
 
 class ASTWriteNode : public ASTNode
 {
 public:
-    ASTWriteNode(Scope<ASTExpressionNode> x, Scope<ASTExpressionNode> y, Scope<ASTExpressionNode> colour);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTWriteNode(ASTExpressionNode* x, ASTExpressionNode* y, ASTExpressionNode* colour);
 public:
-    Scope<ASTExpressionNode> x;
-    Scope<ASTExpressionNode> y;
-    Scope<ASTExpressionNode> colour;
+    ASTExpressionNode* x;
+    ASTExpressionNode* y;
+    ASTExpressionNode* colour;
 };
 
 class ASTWriteBoxNode : public ASTNode
 {
 public:
-    ASTWriteBoxNode(Scope<ASTExpressionNode> x, Scope<ASTExpressionNode> y, Scope<ASTExpressionNode> w, Scope<ASTExpressionNode> h, Scope<ASTExpressionNode> colour);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTWriteBoxNode(ASTExpressionNode* x, ASTExpressionNode* y, ASTExpressionNode* w, ASTExpressionNode* h, ASTExpressionNode* colour);
 public:
-    Scope<ASTExpressionNode> x;
-    Scope<ASTExpressionNode> y;
-    Scope<ASTExpressionNode> w;
-    Scope<ASTExpressionNode> h;
-    Scope<ASTExpressionNode> colour;
+    ASTExpressionNode* x;
+    ASTExpressionNode* y;
+    ASTExpressionNode* w;
+    ASTExpressionNode* h;
+    ASTExpressionNode* colour;
 };
 
 class ASTWidthNode : public ASTExpressionNode
 {
 public:
-    ASTWidthNode() {}
+    ASTWidthNode()
+        : ASTExpressionNode(NodeKind::WIDTH)
+    {}
     
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
 };
 
 class ASTHeightNode : public ASTExpressionNode
 {
 public:
-    ASTHeightNode() {}
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTHeightNode()
+        : ASTExpressionNode(NodeKind::HEIGHT)
+    {}
 };
 
 class ASTReadNode : public ASTExpressionNode
 {
 public:
-    ASTReadNode(Scope<ASTExpressionNode> x, Scope<ASTExpressionNode> y);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTReadNode(ASTExpressionNode* x, ASTExpressionNode* y);
 public:
-    Scope<ASTExpressionNode> x;
-    Scope<ASTExpressionNode> y;
+    ASTExpressionNode* x;
+    ASTExpressionNode* y;
 };
 
 class ASTClearNode : public ASTExpressionNode
 {
 public:
-    ASTClearNode(std::unique_ptr<ASTExpressionNode> expr);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTClearNode(ASTExpressionNode* expr);
 public:
-    std::unique_ptr<ASTExpressionNode> expr;
+    ASTExpressionNode* expr;
 };
 
 class ASTRandIntNode : public ASTExpressionNode
 {
 public:
-    ASTRandIntNode(Scope<ASTExpressionNode> max);
-
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    ASTRandIntNode(ASTExpressionNode* max);
 public:
-    Scope<ASTExpressionNode> max;
+    ASTExpressionNode* max;
 };
 
 class ASTFuncCallNode : public ASTExpressionNode
 {
 public:
-    ASTFuncCallNode(const std::string& funcName);
-
-    void AddArg(Scope< ASTExpressionNode> arg);
+    ASTFuncCallNode(SymbolID funcName, std::pmr::memory_resource* resource);
 
-    inline virtual void accept(Visitor& visitor) override { visitor.visit(*this); };
+    void AddArg(ASTExpressionNode* arg);
 public:
-    std::string funcName;
-    std::vector<Scope<ASTExpressionNode>> args;
-};
\ No newline at end of file
+    SymbolID funcName;
+    SmallVector<ASTExpressionNode*, 3> args;
+};
+
+template<typename V>
+void ASTNode::accept(V& visitor)
+{
+    // Visits through a StackGuard so deeply nested programs cannot overflow the stack
+    StackGuard::Call([&]()
+    {
+        switch (kind)
+        {
+#define X(name, type) case NodeKind::name: visitor.visit(static_cast<type&>(*this)); break;
+            AST_NODES
+#undef X
+        default:
+            break;
+        }
+    });
+}
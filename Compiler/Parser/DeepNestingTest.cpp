@@ -0,0 +1,90 @@
+// Parses, analyzes and generates code for programs nested 1,000,000 deep, which overflow
+// the stack unless the recursion goes through StackGuard, and checks that a syntax error
+// at the bottom of the nesting is still reported. Not part of the compiler's build. From
+// the Compiler directory:
+//   g++ -std=c++20 -O2 -I. Parser/DeepNestingTest.cpp Lexer/Lexer.cpp Parser/Parser.cpp Parser/ASTNodes.cpp
+//       "Semantic Analyzer/SemanticAnalyzerVisitor.cpp" "Code Generation/CodeGenVisitor.cpp"
+//       Utils/SourceBuffer.cpp Utils/StackGuard.cpp -lpthread -o DeepNestingTest
+//   ./DeepNestingTest
+#include "Parser.h"
+#include "Semantic Analyzer/SemanticAnalyzerVisitor.h"
+#include "Code Generation/CodeGenVisitor.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    constexpr int DEPTH = 1000000;
+
+    std::string Repeat(std::string_view text, int count)
+    {
+        std::string repeated;
+        repeated.reserve(text.size() * count);
+        for (int i = 0; i < count; i++)
+            repeated += text;
+        return repeated;
+    }
+
+    // Runs every stage over the program, returning the error message if one failed
+    std::string Compile(const std::string& program)
+    {
+        SourceBuffer source(program);
+        Parser parser;
+        ASTContext context;
+        try
+        {
+            ASTProgramNode* programAST = parser.Parse(source, context);
+
+            SemanticAnalyzerVisitor analyzer{ source };
+            programAST->accept(analyzer);
+
+            CodeGenVisitor codeGen;
+            programAST->accept(codeGen);
+            if (codeGen.Finalize().find("print") == std::string::npos)
+                return "no print instruction was generated";
+        }
+        catch (Parser::SyntaxErrorException& e)
+        {
+            return e.what();
+        }
+        catch (SemanticErrorException& e)
+        {
+            return e.what();
+        }
+        catch (StackGuard::TooDeepException& e)
+        {
+            return e.what();
+        }
+
+        return "";
+    }
+
+    bool Check(const std::string& name, const std::string& program, bool expectError)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::string error = Compile(program);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        bool passed = error.empty() != expectError;
+        std::cout << (passed ? "passed " : "FAILED ") << name << " in " << elapsed.count() << " ms";
+        if (!error.empty())
+            std::cout << ": " << error;
+        std::cout << "\n";
+        return passed;
+    }
+}
+
+int main()
+{
+    bool passed = true;
+
+    passed &= Check("parentheses", "let x:int = " + Repeat("(", DEPTH) + "1" + Repeat(")", DEPTH) + ";\n__print x;\n", false);
+    passed &= Check("negations", "let x:int = " + Repeat("-", DEPTH) + "1;\n__print x;\n", false);
+    passed &= Check("if blocks", "let x:int = 0;\n" + Repeat("if (true) {", DEPTH) + "x = 1;" + Repeat("}", DEPTH) + "\n__print x;\n", false);
+    passed &= Check("unclosed parentheses", "let x:int = " + Repeat("(", DEPTH) + "1" + Repeat(")", DEPTH - 1) + ";\n__print x;\n", true);
+    passed &= Check("type error", "let x:int = " + Repeat("(", DEPTH) + "true" + Repeat(")", DEPTH) + ";\n__print x;\n", true);
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,307 @@
+#include "FlatAST.h"
+
+#include <bit>
+
+namespace
+{
+    // Appends every node it visits with its children after it. Child indices are
+    // collected on a stack and copied into the shared buffer once all are known,
+    // so each node's children stay contiguous
+    class FlatASTBuilder final : public Visitor
+    {
+    public:
+        FlatASTBuilder(FlatAST& ast)
+            : ast(ast)
+        {}
+
+        uint32_t Add(ASTNode* node)
+        {
+            if (!node)
+                return FlatAST::NONE;
+
+            node->accept(*this);
+            return lastIndex;
+        }
+
+        virtual void visit(ASTProgramNode& node) override { Emit(node, NodeKind::PROGRAM, { node.blockNode }); }
+        virtual void visit(ASTBlockNode& node) override { EmitList(node, NodeKind::BLOCK, node.statements); }
+
+        virtual void visit(ASTIntLiteralNode& node) override { Emit(node, NodeKind::INT_LITERAL, {}, 0, (uint32_t)node.value); }
+        virtual void visit(ASTFloatLiteralNode& node) override { Emit(node, NodeKind::FLOAT_LITERAL, {}, 0, std::bit_cast<uint32_t>(node.value)); }
+        virtual void visit(ASTBooleanLiteralNode& node) override { Emit(node, NodeKind::BOOLEAN_LITERAL, {}, 0, node.value); }
+        virtual void visit(ASTColourLiteralNode& node) override { Emit(node, NodeKind::COLOUR_LITERAL, {}, 0, (uint32_t)node.value); }
+
+        virtual void visit(ASTIdentifierNode& node) override
+        {
+            Emit(node, NodeKind::IDENTIFIER, {}, (uint8_t)node.type, node.name, node.arraySize);
+        }
+
+        virtual void visit(ASTArrayIndexNode& node) override
+        {
+            Emit(node, NodeKind::ARRAY_INDEX, { node.index }, (uint8_t)node.type, node.name, node.arraySize);
+        }
+
+        virtual void visit(ASTArraySetNode& node) override
+        {
+            EmitList(node, NodeKind::ARRAY_SET, node.literals, 0, 0, node.duplication);
+        }
+
+        virtual void visit(ASTVarDeclNode& node) override { Emit(node, NodeKind::VAR_DECL, { node.identifier, node.value }); }
+        virtual void visit(ASTBinaryOpNode& node) override { Emit(node, NodeKind::BINARY_OP, { node.left, node.right }, (uint8_t)node.type); }
+        virtual void visit(ASTNegateNode& node) override { Emit(node, NodeKind::NEGATE, { node.expr }); }
+        virtual void visit(ASTNotNode& node) override { Emit(node, NodeKind::NOT, { node.expr }); }
+        virtual void visit(ASTCastNode& node) override { Emit(node, NodeKind::CAST, { node.expr }, (uint8_t)node.castType); }
+        virtual void visit(ASTAssignmentNode& node) override { Emit(node, NodeKind::ASSIGNMENT, { node.identifier, node.expr }); }
+
+        virtual void visit(ASTDecisionNode& node) override
+        {
+            Emit(node, NodeKind::DECISION, { node.expr, node.trueStatement, node.falseStatement });
+        }
+
+        virtual void visit(ASTReturnNode& node) override { Emit(node, NodeKind::RETURN, { node.expr }); }
+
+        virtual void visit(ASTFunctionNode& node) override
+        {
+            uint32_t index = Reserve();
+            size_t mark = pending.size();
+            pending.push_back(Add(node.Body()));
+
+            // Parameters become nodes of their own after the block
+            for (const auto& param : node.params)
+            {
+                pending.push_back((uint32_t)ast.nodes.size());
+                ast.nodes.push_back({ NodeKind::PARAM, (uint8_t)param.Type, node.sourceIndex, param.Name, param.ArraySize });
+            }
+
+            Finish(index, mark, node, NodeKind::FUNCTION, (uint8_t)node.returnType, node.name, node.returnSize);
+        }
+
+        virtual void visit(ASTWhileNode& node) override { Emit(node, NodeKind::WHILE, { node.expr, node.blockNode }); }
+
+        virtual void visit(ASTForNode& node) override
+        {
+            Emit(node, NodeKind::FOR, { node.variableDecl, node.expr, node.assignment, node.blockNode });
+        }
+
+        virtual void visit(ASTPrintNode& node) override { Emit(node, NodeKind::PRINT, { node.expr }); }
+        virtual void visit(ASTDelayNode& node) override { Emit(node, NodeKind::DELAY, { node.delayExpr }); }
+        virtual void visit(ASTWriteNode& node) override { Emit(node, NodeKind::WRITE, { node.x, node.y, node.colour }); }
+
+        virtual void visit(ASTWriteBoxNode& node) override
+        {
+            Emit(node, NodeKind::WRITE_BOX, { node.x, node.y, node.w, node.h, node.colour });
+        }
+
+        virtual void visit(ASTWidthNode& node) override { Emit(node, NodeKind::WIDTH, {}); }
+        virtual void visit(ASTHeightNode& node) override { Emit(node, NodeKind::HEIGHT, {}); }
+        virtual void visit(ASTReadNode& node) override { Emit(node, NodeKind::READ, { node.x, node.y }); }
+        virtual void visit(ASTClearNode& node) override { Emit(node, NodeKind::CLEAR, { node.expr }); }
+        virtual void visit(ASTRandIntNode& node) override { Emit(node, NodeKind::RAND_INT, { node.max }); }
+
+        virtual void visit(ASTFuncCallNode& node) override
+        {
+            EmitList(node, NodeKind::FUNC_CALL, node.args, 0, node.funcName);
+        }
+
+    private:
+        uint32_t Reserve()
+        {
+            ast.nodes.emplace_back();
+            return (uint32_t)ast.nodes.size() - 1;
+        }
+
+        // Moves the child indices pushed since mark into the shared buffer and fills in the node
+        void Finish(uint32_t index, size_t mark, ASTNode& node, NodeKind kind, uint8_t type, uint32_t value, int32_t arraySize)
+        {
+            FlatAST::Node& flatNode = ast.nodes[index];
+            flatNode.kind = kind;
+            flatNode.type = type;
+            flatNode.sourceIndex = node.sourceIndex;
+            flatNode.value = value;
+            flatNode.arraySize = arraySize;
+            flatNode.firstChild = (uint32_t)ast.children.size();
+            flatNode.numChildren = (uint32_t)(pending.size() - mark);
+
+            ast.children.insert(ast.children.end(), pending.begin() + mark, pending.end());
+            pending.resize(mark);
+            lastIndex = index;
+        }
+
+        void Emit(ASTNode& node, NodeKind kind, std::initializer_list<ASTNode*> nodeChildren,
+            uint8_t type = 0, uint32_t value = 0, int32_t arraySize = -1)
+        {
+            uint32_t index = Reserve();
+            size_t mark = pending.size();
+            for (ASTNode* child : nodeChildren)
+                pending.push_back(Add(child));
+
+            Finish(index, mark, node, kind, type, value, arraySize);
+        }
+
+        template<typename List>
+        void EmitList(ASTNode& node, NodeKind kind, const List& nodeChildren,
+            uint8_t type = 0, uint32_t value = 0, int32_t arraySize = -1)
+        {
+            uint32_t index = Reserve();
+            size_t mark = pending.size();
+            for (ASTNode* child : nodeChildren)
+                pending.push_back(Add(child));
+
+            Finish(index, mark, node, kind, type, value, arraySize);
+        }
+
+    private:
+        FlatAST& ast;
+        std::vector<uint32_t> pending;
+        uint32_t lastIndex = FlatAST::NONE;
+    };
+
+    class TreeBuilder
+    {
+    public:
+        TreeBuilder(const FlatAST& ast, ASTContext& context)
+            : ast(ast), context(context)
+        {}
+
+        template<typename T = ASTNode>
+        T* Build(uint32_t index)
+        {
+            if (index == FlatAST::NONE)
+                return nullptr;
+
+            ASTNode* node = StackGuard::Call([&]() { return BuildNode(ast[index]); });
+            node->sourceIndex = ast[index].sourceIndex;
+            return static_cast<T*>(node);
+        }
+
+    private:
+        ASTNode* BuildNode(const FlatAST::Node& node)
+        {
+            auto children = ast.Children(node);
+            auto child = [&](size_t i) { return Build<ASTExpressionNode>(children[i]); };
+
+            switch (node.kind)
+            {
+            case NodeKind::PROGRAM:
+                return context.Create<ASTProgramNode>(Build<ASTBlockNode>(children[0]));
+            case NodeKind::BLOCK:
+            {
+                auto block = context.Create<ASTBlockNode>(context.Resource());
+                block->statements.reserve(children.size());
+                for (uint32_t statement : children)
+                    block->AddStatement(Build(statement));
+                return block;
+            }
+            case NodeKind::IDENTIFIER:
+                return context.Create<ASTIdentifierNode>(node.value, (Tokens::VarType::Type)node.type, node.arraySize);
+            case NodeKind::ARRAY_INDEX:
+            {
+                auto arrayIndex = context.Create<ASTArrayIndexNode>(node.value, child(0));
+                arrayIndex->type = (Tokens::VarType::Type)node.type;
+                arrayIndex->arraySize = node.arraySize;
+                return arrayIndex;
+            }
+            case NodeKind::ARRAY_SET:
+            {
+                auto arraySet = context.Create<ASTArraySetNode>(context.Resource());
+                arraySet->duplication = node.arraySize;
+                arraySet->literals.reserve(children.size());
+                for (size_t i = 0; i < children.size(); i++)
+                    arraySet->AddLiterial(child(i));
+                return arraySet;
+            }
+            case NodeKind::INT_LITERAL:
+                return context.Create<ASTIntLiteralNode>((int)node.value);
+            case NodeKind::FLOAT_LITERAL:
+                return context.Create<ASTFloatLiteralNode>(std::bit_cast<float>(node.value));
+            case NodeKind::BOOLEAN_LITERAL:
+                return context.Create<ASTBooleanLiteralNode>(node.value != 0);
+            case NodeKind::COLOUR_LITERAL:
+                return context.Create<ASTColourLiteralNode>((int)node.value);
+            case NodeKind::VAR_DECL:
+                return context.Create<ASTVarDeclNode>(Build<ASTIdentifierNode>(children[0]), child(1));
+            case NodeKind::BINARY_OP:
+                return context.Create<ASTBinaryOpNode>((ASTBinaryOpNode::Type)node.type, child(0), child(1));
+            case NodeKind::NEGATE:
+                return context.Create<ASTNegateNode>(child(0));
+            case NodeKind::NOT:
+                return context.Create<ASTNotNode>(child(0));
+            case NodeKind::CAST:
+                return context.Create<ASTCastNode>((Tokens::VarType::Type)node.type, child(0));
+            case NodeKind::ASSIGNMENT:
+                return context.Create<ASTAssignmentNode>(Build<ASTIdentifierNode>(children[0]), child(1));
+            case NodeKind::DECISION:
+                return context.Create<ASTDecisionNode>(child(0), Build<ASTBlockNode>(children[1]), Build<ASTBlockNode>(children[2]));
+            case NodeKind::RETURN:
+                return context.Create<ASTReturnNode>(child(0));
+            case NodeKind::FUNCTION:
+            {
+                ASTFunctionNode::ParamList params(context.Resource());
+                params.reserve(children.size() - 1);
+                for (size_t i = 1; i < children.size(); i++)
+                {
+                    const FlatAST::Node& param = ast[children[i]];
+                    params.emplace_back(param.value, (Tokens::VarType::Type)param.type, param.arraySize);
+                }
+
+                return context.Create<ASTFunctionNode>(node.value, std::move(params), (Tokens::VarType::Type)node.type,
+                    node.arraySize, Build<ASTBlockNode>(children[0]));
+            }
+            case NodeKind::WHILE:
+                return context.Create<ASTWhileNode>(child(0), Build<ASTBlockNode>(children[1]));
+            case NodeKind::FOR:
+                return context.Create<ASTForNode>(Build<ASTVarDeclNode>(children[0]), child(1),
+                    Build<ASTAssignmentNode>(children[2]), Build<ASTBlockNode>(children[3]));
+            case NodeKind::PRINT:
+                return context.Create<ASTPrintNode>(child(0));
+            case NodeKind::DELAY:
+                return context.Create<ASTDelayNode>(child(0));
+            case NodeKind::WRITE:
+                return context.Create<ASTWriteNode>(child(0), child(1), child(2));
+            case NodeKind::WRITE_BOX:
+                return context.Create<ASTWriteBoxNode>(child(0), child(1), child(2), child(3), child(4));
+            case NodeKind::WIDTH:
+                return context.Create<ASTWidthNode>();
+            case NodeKind::HEIGHT:
+                return context.Create<ASTHeightNode>();
+            case NodeKind::READ:
+                return context.Create<ASTReadNode>(child(0), child(1));
+            case NodeKind::CLEAR:
+                return context.Create<ASTClearNode>(child(0));
+            case NodeKind::RAND_INT:
+                return context.Create<ASTRandIntNode>(child(0));
+            case NodeKind::FUNC_CALL:
+            {
+                auto funcCall = context.Create<ASTFuncCallNode>(node.value, context.Resource());
+                funcCall->args.reserve(children.size());
+                for (size_t i = 0; i < children.size(); i++)
+                    funcCall->AddArg(child(i));
+                return funcCall;
+            }
+            case NodeKind::PARAM:
+                break;
+            }
+
+            // PARAM nodes are only reached through their function
+            return nullptr;
+        }
+
+    private:
+        const FlatAST& ast;
+        ASTContext& context;
+    };
+}
+
+FlatAST FlatAST::FromTree(ASTProgramNode& program)
+{
+    FlatAST ast;
+    FlatASTBuilder builder(ast);
+    builder.Add(&program);
+    return ast;
+}
+
+ASTProgramNode* FlatAST::ToTree(ASTContext& context) const
+{
+    TreeBuilder builder(*this, context);
+    return builder.Build<ASTProgramNode>(ROOT);
+}
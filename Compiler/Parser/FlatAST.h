@@ -0,0 +1,71 @@
+#pragma once
+#include <vector>
+#include <span>
+#include <cstdint>
+
+#include "ASTNodes.h"
+#include "ASTContext.h"
+
+// AST stored as one array of fixed size nodes that refer to their children by 32-bit
+// index. Child lists are ranges of a shared index buffer, so the whole tree is two
+// contiguous arrays that can be walked without chasing pointers and written out as is.
+// FromTree and ToTree convert from and to the pointer tree that the visitors walk
+//
+// Children of each kind, in order:
+//   PROGRAM       block
+//   BLOCK         statements
+//   ARRAY_INDEX   index
+//   ARRAY_SET     literals
+//   VAR_DECL      identifier, value
+//   BINARY_OP     left, right
+//   NEGATE, NOT, CAST, RETURN, PRINT, DELAY, CLEAR, RAND_INT   expression
+//   ASSIGNMENT    identifier, expression
+//   DECISION      expression, true block, false block or NONE
+//   FUNCTION      block, parameters
+//   WHILE         expression, block
+//   FOR           declaration or NONE, expression, assignment or NONE, block
+//   WRITE         x, y, colour
+//   WRITE_BOX     x, y, w, h, colour
+//   READ          x, y
+//   FUNC_CALL     arguments
+class FlatAST
+{
+public:
+    // Marks a missing optional child
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Node
+    {
+        NodeKind kind = NodeKind::PROGRAM;
+        // Operator, variable, cast or return type, depending on the kind
+        uint8_t type = 0;
+        uint32_t sourceIndex = 0;
+        // Symbol of named nodes or the bits of a literal
+        uint32_t value = 0;
+        // Array size of identifiers, parameters and function returns, duplication of array sets
+        int32_t arraySize = -1;
+        uint32_t firstChild = 0;
+        uint32_t numChildren = 0;
+    };
+
+public:
+    static FlatAST FromTree(ASTProgramNode& program);
+    // Builds the pointer tree in the context
+    ASTProgramNode* ToTree(ASTContext& context) const;
+
+    // The program is always the first node
+    static constexpr uint32_t ROOT = 0;
+
+    inline const Node& operator[](uint32_t index) const { return nodes[index]; }
+
+    inline std::span<const uint32_t> Children(const Node& node) const
+    {
+        return { children.data() + node.firstChild, node.numChildren };
+    }
+
+    inline size_t size() const { return nodes.size(); }
+
+public:
+    std::vector<Node> nodes;
+    std::vector<uint32_t> children;
+};
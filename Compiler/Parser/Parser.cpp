@@ -2,51 +2,104 @@
 
 using namespace Tokens;
 
-Parser::Parser()
+namespace
 {
+    using BindingPowerTable = std::array<uint8_t, (size_t)Token::Type::END_OF_FILE + 1>;
+
+    // Binding power of every binary operator token, 0 for tokens that end an expression.
+    // Higher powers bind tighter and operators of the same power are left associative
+    constexpr BindingPowerTable InitBindingPowers()
+    {
+        BindingPowerTable bindingPowers{};
+        bindingPowers[(size_t)RelationalOp::TokenType] = 1;
+        bindingPowers[(size_t)AdditiveOp::TokenType] = 2;
+        bindingPowers[(size_t)MultiplicativeOp::TokenType] = 3;
+        return bindingPowers;
+    }
+
+    constexpr BindingPowerTable bindingPowers = InitBindingPowers();
 }
 
-Scope<ASTProgramNode> Parser::Parse(const std::string& program)
+Parser::Parser(bool lazyFunctionBodies)
+    : lazyFunctionBodies(lazyFunctionBodies)
 {
-    programIndex = 0;
-    this->program = program;
-    return CreateScope<ASTProgramNode>(std::move(ParseBlock(true)));
 }
 
-Scope<ASTBlockNode> Parser::ParseBlock(bool root)
+ASTProgramNode* Parser::Parse(const SourceBuffer& source, ASTContext& context)
 {
-    auto blockNode = CreateScope<ASTBlockNode>();
+    if (source.size() >= Lexer::PARALLEL_SIZE)
+        return Parse(source, lexer.TokenizeParallel(source, ThreadPool::Global()), context);
 
-    auto token = PeekNextToken();
+    return Parse(source, lexer.Tokenize(source), context);
+}
 
-    // Root program node does not need curly brackets to define a scope
-    if (!root)
-    {
-        ASSERT(CHECK_SUB_TYPE(token, Bracket, type == Bracket::Type::OPEN_CURLY_BRACK));
-        JumpToken(token->lexemeLength);
-        token = PeekNextToken();
-    }
+ASTProgramNode* Parser::Parse(const SourceBuffer& source, std::vector<Token> tokens, ASTContext& context)
+{
+    this->source = &source;
+    this->context = &context;
+    this->tokenStorage = std::move(tokens);
+    this->tokens = tokenStorage;
+    tokenIndex = 0;
+    pastTokenIndex = 0;
+#ifdef _DEBUG
+    consumedTokens = 0;
+    rewinds = 0;
+#endif
+    // Lazy bodies are cheaper still, so they are not parsed ahead
+    if (!lazyFunctionBodies && this->tokens.size() >= PARALLEL_TOKENS)
+        ParseFunctionBodiesParallel(ThreadPool::Global());
+
+    auto programNode = CreateNode<ASTProgramNode>(0, ParseBlock(true));
+    parsedBodies.clear();
+
+    return programNode;
+}
 
-    while ((root && token->type != Token::Type::END_OF_FILE) || (!root && !CHECK_SUB_TYPE(token, Bracket, type == Bracket::Type::CLOSE_CURLY_BRACK)))
+ASTProgramNode* Parser::Parse(std::string_view program, ASTContext& context)
+{
+    wrappedSource = SourceBuffer(program);
+    return Parse(wrappedSource, context);
+}
+
+ASTBlockNode* Parser::ParseBlock(bool root)
+{
+    // Blocks nest through if, while and for statements
+    return StackGuard::Call([&]()
     {
-        blockNode->AddStatement(std::move(ParseStatement()));
-        token = PeekNextToken();
-    }
+        int startToken = tokenIndex;
+        auto blockNode = CreateNode<ASTBlockNode>(startToken, context->Resource());
 
-    JumpToken(token->lexemeLength);
+        auto token = PeekNextToken();
 
-    return std::move(blockNode);
+        // Root program node does not need curly brackets to define a scope
+        if (!root)
+        {
+            ASSERT(CHECK_SUB_TYPE(token, Bracket, type == Bracket::Type::OPEN_CURLY_BRACK));
+            JumpToken();
+            token = PeekNextToken();
+        }
+
+        while ((root && token.type != Token::Type::END_OF_FILE) || (!root && !CHECK_SUB_TYPE(token, Bracket, type == Bracket::Type::CLOSE_CURLY_BRACK)))
+        {
+            blockNode->AddStatement(ParseStatement());
+            token = PeekNextToken();
+        }
+
+        JumpToken();
+
+        return blockNode;
+    });
 }
 
-Scope<ASTNode> Parser::ParseStatement()
+ASTNode* Parser::ParseStatement()
 {
     auto token = PeekNextToken();
 
-    switch (token->type)
+    switch (token.type)
     {
         case Token::Type::KEYWORD:
         {
-            Keyword& keywordToken = token->As<Keyword>();
+            Keyword keywordToken = token.As<Keyword>();
             switch (keywordToken.type)
             {
                 case Keyword::Type::LET:
@@ -54,12 +107,12 @@ Scope<ASTNode> Parser::ParseStatement()
                     auto variable = ParseVariableDeclaration();
                     token = GetNextToken();
                     ASSERT(CHECK_SUB_TYPE(token, Punctuation, type == Punctuation::Type::SEMICOLON));
-                    return std::move(variable);
+                    return variable;
                 }
 
                 case Keyword::Type::IF:
                 {
-                    return std::move(ParseIfStatement());
+                    return ParseIfStatement();
                 }
 
                 case Keyword::Type::RETURN:
@@ -67,22 +120,22 @@ Scope<ASTNode> Parser::ParseStatement()
                     auto retStatement = ParseReturnStatement();
                     token = GetNextToken();
                     ASSERT(CHECK_SUB_TYPE(token, Punctuation, type == Punctuation::Type::SEMICOLON));
-                    return std::move(retStatement);
+                    return retStatement;
                 }
 
                 case Keyword::Type::FUN:
                 {
-                    return std::move(ParseFunctionDecl());
+                    return ParseFunctionDecl();
                 }
 
                 case Keyword::Type::WHILE:
                 {
-                    return std::move(ParseWhileLoop());
+                    return ParseWhileLoop();
                 }
 
                 case Keyword::Type::FOR:
                 {
-                    return std::move(ParseForLoop());
+                    return ParseForLoop();
                 }
             }
             break;
@@ -93,12 +146,12 @@ Scope<ASTNode> Parser::ParseStatement()
             auto assignment = ParseAssignment();
             token = GetNextToken();
             ASSERT(CHECK_SUB_TYPE(token, Punctuation, type == Punctuation::Type::SEMICOLON));
-            return std::move(assignment);
+            return assignment;
         }
 
         case Token::Type::BUILTIN:
         {
-            Builtin& builtinToken = token->As<Builtin>();
+            Builtin builtinToken = token.As<Builtin>();
             switch (builtinToken.type)
             {
                 case Builtin::Type::PRINT:
@@ -106,7 +159,7 @@ Scope<ASTNode> Parser::ParseStatement()
                     auto print = ParsePrint();
                     token = GetNextToken();
                     ASSERT(CHECK_SUB_TYPE(token, Punctuation, type == Punctuation::Type::SEMICOLON));
-                    return std::move(print);
+                    return print;
                 }
 
                 case Builtin::Type::DELAY:
@@ -114,7 +167,7 @@ Scope<ASTNode> Parser::ParseStatement()
                     auto delay = ParseDelay();
                     token = GetNextToken();
                     ASSERT(CHECK_SUB_TYPE(token, Punctuation, type == Punctuation::Type::SEMICOLON));
-                    return std::move(delay);
+                    return delay;
                 }
 
                 case Builtin::Type::WRITE:
@@ -122,7 +175,7 @@ Scope<ASTNode> Parser::ParseStatement()
                     auto write = ParseWrite();
                     token = GetNextToken();
                     ASSERT(CHECK_SUB_TYPE(token, Punctuation, type == Punctuation::Type::SEMICOLON));
-                    return std::move(write);
+                    return write;
                 }
 
                 case Builtin::Type::WRITE_BOX:
@@ -130,7 +183,7 @@ Scope<ASTNode> Parser::ParseStatement()
                     auto writeBox = ParseWriteBox();
                     token = GetNextToken();
                     ASSERT(CHECK_SUB_TYPE(token, Punctuation, type == Punctuation::Type::SEMICOLON));
-                    return std::move(writeBox);
+                    return writeBox;
                 }
 
                 case Builtin::Type::CLEAR:
@@ -138,69 +191,72 @@ Scope<ASTNode> Parser::ParseStatement()
                     auto clear = ParseClear();
                     token = GetNextToken();
                     ASSERT(CHECK_SUB_TYPE(token, Punctuation, type == Punctuation::Type::SEMICOLON));
-                    return std::move(clear);
+                    return clear;
                 }
             }
         }
     }
 
 
-    throw SyntaxErrorException(program, programIndex, __LINE__);
+    ThrowSyntaxError(ProgramIndex(tokenIndex), __LINE__);
 }
 
-Scope<ASTVarDeclNode> Parser::ParseVariableDeclaration()
+ASTVarDeclNode* Parser::ParseVariableDeclaration()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Keyword, type == Keyword::Type::LET));
 
     nextToken = GetNextToken();
-    ASSERT(nextToken->type == Token::Type::IDENTIFIER);
+    ASSERT(nextToken.type == Token::Type::IDENTIFIER);
+    int identifierToken = pastTokenIndex;
 
-    std::string identifierName = nextToken->As<Identifier>().name;
+    SymbolID identifierName = Identifier(nextToken).symbol;
 
     nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Punctuation, type == Punctuation::Type::COLON));
 
     nextToken = GetNextToken();
-    ASSERT(nextToken->type == Token::Type::VAR_TYPE);
+    ASSERT(nextToken.type == Token::Type::VAR_TYPE);
 
-    auto varType = nextToken->As<VarType>().type;
+    auto varType = nextToken.As<VarType>().type;
 
-    Scope<ASTExpressionNode> expression;
+    ASTExpressionNode* expression;
     int arraySize = -1;
 
     nextToken = GetNextToken();
-    ASSERT(nextToken->type == Token::Type::ASSIGNMENT || CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::OPEN_SQ_BRACK));
+    ASSERT(nextToken.type == Token::Type::ASSIGNMENT || CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::OPEN_SQ_BRACK));
 
     // Array variable declaration
-    if(nextToken->type == Token::Type::BRACKET)
+    if(nextToken.type == Token::Type::BRACKET)
     {
         nextToken = GetNextToken();
         // Allows either x[10] or x[]
-        ASSERT(nextToken->type == Token::Type::INT_LITERAL || CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::CLOSE_SQ_BRACK));
-        if (nextToken->type == Token::Type::INT_LITERAL)
+        ASSERT(nextToken.type == Token::Type::INT_LITERAL || CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::CLOSE_SQ_BRACK));
+        if (nextToken.type == Token::Type::INT_LITERAL)
         {
-            arraySize = nextToken->As<IntegerLiteral>().value;
+            arraySize = nextToken.As<IntegerLiteral>().value;
             nextToken = GetNextToken();
             ASSERT(CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::CLOSE_SQ_BRACK));
         }
 
         nextToken = GetNextToken();
-        ASSERT(nextToken->type == Token::Type::ASSIGNMENT);
+        ASSERT(nextToken.type == Token::Type::ASSIGNMENT);
 
         nextToken = GetNextToken();
         ASSERT(CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::OPEN_SQ_BRACK));
+        int arraySetToken = pastTokenIndex;
 
-        Scope<ASTArraySetNode> arraySetNode;
+        ASTArraySetNode* arraySetNode;
 
         // If the array size depends on the number of hardcoded elements
         if (arraySize == -1)
         {
-            arraySetNode = CreateScope<ASTArraySetNode>();
+            arraySetNode = CreateNode<ASTArraySetNode>(arraySetToken, context->Resource());
             arraySize = 0;
             while (!CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::CLOSE_SQ_BRACK))
             {
-                arraySetNode->AddLiterial(std::move(ParseLiteral()));
+                arraySetNode->AddLiterial(ParseLiteral());
                 arraySize++;
                 nextToken = GetNextToken();
                 ASSERT(CHECK_SUB_TYPE(nextToken, Punctuation, type == Punctuation::Type::COMMA) ||
@@ -209,119 +265,115 @@ Scope<ASTVarDeclNode> Parser::ParseVariableDeclaration()
         }
         else
         {
-            arraySetNode = CreateScope<ASTArraySetNode>(std::move(ParseLiteral()), arraySize);
+            arraySetNode = CreateNode<ASTArraySetNode>(arraySetToken, context->Resource(), ParseLiteral(), arraySize);
             nextToken = GetNextToken();
             ASSERT(CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::CLOSE_SQ_BRACK));
         }
 
-        expression = std::move(arraySetNode);
+        expression = arraySetNode;
     }
     else
     {
         expression = ParseExpression(); 
     }
 
-    Scope<ASTIdentifierNode> identifier = CreateScope<ASTIdentifierNode>(identifierName, varType, arraySize);
+    ASTIdentifierNode* identifier = CreateNode<ASTIdentifierNode>(identifierToken, identifierName, varType, arraySize);
 
-    return CreateScope<ASTVarDeclNode>(std::move(identifier), std::move(expression));
+    return CreateNode<ASTVarDeclNode>(startToken, identifier, expression);
 }
 
-Scope<ASTAssignmentNode> Parser::ParseAssignment()
+ASTAssignmentNode* Parser::ParseAssignment()
 {
+    int startToken = tokenIndex;
     auto identifier = ParseIdentifier();
 
     auto nextToken = GetNextToken();
-    ASSERT(nextToken->type == Token::Type::ASSIGNMENT);
+    ASSERT(nextToken.type == Token::Type::ASSIGNMENT);
 
     auto expr = ParseExpression();
 
-    return CreateScope<ASTAssignmentNode>(std::move(identifier), std::move(expr));
+    return CreateNode<ASTAssignmentNode>(startToken, identifier, expr);
 }
 
-Scope<ASTExpressionNode> Parser::ParseExpression(bool subExpr)
+ASTExpressionNode* Parser::ParseExpression(bool subExpr)
 {
-    auto curExpr = ParseSimpleExpression();
-
-    auto nextToken = PeekNextToken();
-    while (nextToken->type == Token::Type::REL_OP)
+    // Expressions nest through brackets, unary operators, indices and arguments
+    return StackGuard::Call([&]()
     {
-        JumpToken(nextToken->lexemeLength);
-        RelationalOp::Type relType = nextToken->As<RelationalOp>().type;
-        auto nextExpr = ParseSimpleExpression();
-        curExpr = CreateScope<ASTBinaryOpNode>(relType, std::move(curExpr), std::move(nextExpr));
-        nextToken = PeekNextToken();
-    }
+        auto curExpr = ParseBinaryExpression(1);
 
-    // Casting
-    if (CHECK_SUB_TYPE(nextToken, Keyword, type == Keyword::Type::AS))
-    {
-        JumpToken(nextToken->lexemeLength);
-        nextToken = GetNextToken();
-        ASSERT(nextToken->type == Token::Type::VAR_TYPE);
-        curExpr = CreateScope<ASTCastNode>(nextToken->As<VarType>().type, std::move(curExpr));
-        nextToken = PeekNextToken();
-    }
+        auto nextToken = PeekNextToken();
 
-    // If this is a sub expression (i.e. expression within brackets) then it needs a close brackets
-    ASSERT(!subExpr || (subExpr && CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::CLOSE_PAREN)));
-    if (subExpr)
-        JumpToken(nextToken->lexemeLength);
+        // Casting
+        if (CHECK_SUB_TYPE(nextToken, Keyword, type == Keyword::Type::AS))
+        {
+            int opToken = tokenIndex;
+            JumpToken();
+            nextToken = GetNextToken();
+            ASSERT(nextToken.type == Token::Type::VAR_TYPE);
+            curExpr = CreateNode<ASTCastNode>(opToken, nextToken.As<VarType>().type, curExpr);
+            nextToken = PeekNextToken();
+        }
 
-    return curExpr;
+        // If this is a sub expression (i.e. expression within brackets) then it needs a close brackets
+        ASSERT(!subExpr || (subExpr && CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::CLOSE_PAREN)));
+        if (subExpr)
+            JumpToken();
+
+        return curExpr;
+    });
 }
 
-Scope<ASTExpressionNode> Parser::ParseSimpleExpression()
+ASTExpressionNode* Parser::ParseBinaryExpression(int minPower)
 {
-    auto curTerm = ParseTerm();
+    auto curExpr = ParseFactor();
 
     auto nextToken = PeekNextToken();
-    while (nextToken->type == Token::Type::ADD_OP)
+    int power = bindingPowers[(size_t)nextToken.type];
+    while (power >= minPower)
     {
-        JumpToken(nextToken->lexemeLength);
-        AdditiveOp::Type additiveType = nextToken->As<AdditiveOp>().type;
-        auto nextTerm = ParseTerm();
-        curTerm = CreateScope<ASTBinaryOpNode>(additiveType, std::move(curTerm), std::move(nextTerm));
-        nextToken = PeekNextToken();
-    }
+        int opToken = tokenIndex;
+        JumpToken();
+        // Operators that bind tighter are folded into the right operand first
+        auto nextExpr = ParseBinaryExpression(power + 1);
 
-    return curTerm;
-}
-
-Scope<ASTExpressionNode> Parser::ParseTerm()
-{
-    auto curFactor = ParseFactor();
+        switch (nextToken.type)
+        {
+        case Token::Type::REL_OP:
+            curExpr = CreateNode<ASTBinaryOpNode>(opToken, nextToken.As<RelationalOp>().type, curExpr, nextExpr);
+            break;
+        case Token::Type::ADD_OP:
+            curExpr = CreateNode<ASTBinaryOpNode>(opToken, nextToken.As<AdditiveOp>().type, curExpr, nextExpr);
+            break;
+        case Token::Type::MULT_OP:
+            curExpr = CreateNode<ASTBinaryOpNode>(opToken, nextToken.As<MultiplicativeOp>().type, curExpr, nextExpr);
+            break;
+        }
 
-    auto nextToken = PeekNextToken();
-    while (nextToken->type == Token::Type::MULT_OP)
-    {
-        JumpToken(nextToken->lexemeLength);
-        MultiplicativeOp::Type multType = nextToken->As<MultiplicativeOp>().type;
-        auto nextFactor = ParseFactor();
-        curFactor = CreateScope<ASTBinaryOpNode>(multType, std::move(curFactor), std::move(nextFactor));
         nextToken = PeekNextToken();
+        power = bindingPowers[(size_t)nextToken.type];
     }
 
-    return curFactor;
+    return curExpr;
 }
 
-Scope<ASTExpressionNode> Parser::ParseFactor()
+ASTExpressionNode* Parser::ParseFactor()
 {
-    auto nextToken = GetNextToken();
-    switch (nextToken->type)
+    int startToken = tokenIndex;
+    auto nextToken = PeekNextToken();
+    switch (nextToken.type)
     {
         // Literals
     case Token::Type::INT_LITERAL:
     case Token::Type::FLOAT_LITERAL:
     case Token::Type::BOOLEAN_LITERAL:
     case Token::Type::COLOUR_LITERAL:
-        UndoToken(nextToken->startIndex);
         return ParseLiteral();
 
         // Builtin keywords
     case Token::Type::BUILTIN:
     {
-        UndoToken(nextToken->startIndex);
-        switch (nextToken->As<Builtin>().type)
+        switch (nextToken.As<Builtin>().type)
         {
         case Builtin::Type::WIDTH:
         case Builtin::Type::HEIGHT:
@@ -330,15 +382,13 @@ Scope<ASTExpressionNode> Parser::ParseFactor()
         case Builtin::Type::RANDOM_INT:
             return ParseRandInt();
         }
-        break;
+        ThrowSyntaxError(ProgramIndex(tokenIndex), __LINE__);
     }
 
-        // Identifier
+        // Identifier, the token after it tells a function call apart
     case Token::Type::IDENTIFIER:
     {
-        auto after = PeekNextToken();
-        UndoToken(nextToken->startIndex);
-        if (CHECK_SUB_TYPE(after, Bracket, type == Bracket::Type::OPEN_PAREN))
+        if (CHECK_SUB_TYPE(PeekNextToken(1), Bracket, type == Bracket::Type::OPEN_PAREN))
         {
             return ParseFunctionCall();
         }
@@ -350,46 +400,39 @@ Scope<ASTExpressionNode> Parser::ParseFactor()
 
         // Sub expression
     case Token::Type::BRACKET:
-        if (nextToken->As<Bracket>().type == Bracket::Type::OPEN_PAREN)
+        if (nextToken.As<Bracket>().type == Bracket::Type::OPEN_PAREN)
         {
+            JumpToken();
             return ParseExpression(true);
         }
         break;
 
         // Unary Operators
     case Token::Type::UNARY_OP:
-        return CreateScope<ASTNotNode>(std::move(ParseExpression()));
+        JumpToken();
+        return CreateNode<ASTNotNode>(startToken, ParseExpression());
 
     case Token::Type::ADD_OP:
-        if (nextToken->As<AdditiveOp>().type == AdditiveOp::Type::SUBTRACT)
+        if (nextToken.As<AdditiveOp>().type == AdditiveOp::Type::SUBTRACT)
         {
-            return CreateScope<ASTNegateNode>(std::move(ParseExpression()));
+            JumpToken();
+            return CreateNode<ASTNegateNode>(startToken, ParseExpression());
         }
         break;
     }
 
-    throw SyntaxErrorException(program, programIndex, __LINE__);
+    // Reports the error after the unexpected token
+    JumpToken();
+    ThrowSyntaxError(ProgramIndex(tokenIndex), __LINE__);
 }
 
-Scope<ASTExpressionNode> Parser::ParseLiteral()
+ASTExpressionNode* Parser::ParseLiteral()
 {
-    auto nextToken = GetNextToken();
-    switch (nextToken->type)
-    {
-        // Literals
-    case Token::Type::INT_LITERAL:
-        return CreateScope<ASTIntLiteralNode>(nextToken->As<IntegerLiteral>().value);
-    case Token::Type::FLOAT_LITERAL:
-        return CreateScope<ASTFloatLiteralNode>(nextToken->As<FloatLiteral>().value);
-    case Token::Type::BOOLEAN_LITERAL:
-        return CreateScope<ASTBooleanLiteralNode>(nextToken->As<BooleanLiteral>().value);
-    case Token::Type::COLOUR_LITERAL:
-        return CreateScope<ASTColourLiteralNode>(nextToken->As<ColourLiteral>().value);
-
-    case Token::Type::BUILTIN:
+    int startToken = tokenIndex;
+    auto nextToken = PeekNextToken();
+    if (nextToken.type == Token::Type::BUILTIN)
     {
-        UndoToken(nextToken->startIndex);
-        switch (nextToken->As<Builtin>().type)
+        switch (nextToken.As<Builtin>().type)
         {
         case Builtin::Type::WIDTH:
             return ParseWidth();
@@ -398,38 +441,58 @@ Scope<ASTExpressionNode> Parser::ParseLiteral()
         case Builtin::Type::READ:
             return ParseRead();
         }
+        ThrowSyntaxError(ProgramIndex(tokenIndex), __LINE__);
     }
+
+    JumpToken();
+    switch (nextToken.type)
+    {
+        // Literals
+    case Token::Type::INT_LITERAL:
+        return CreateNode<ASTIntLiteralNode>(startToken, nextToken.As<IntegerLiteral>().value);
+    case Token::Type::FLOAT_LITERAL:
+        return CreateNode<ASTFloatLiteralNode>(startToken, nextToken.As<FloatLiteral>().value);
+    case Token::Type::BOOLEAN_LITERAL:
+        return CreateNode<ASTBooleanLiteralNode>(startToken, nextToken.As<BooleanLiteral>().value);
+    case Token::Type::COLOUR_LITERAL:
+        return CreateNode<ASTColourLiteralNode>(startToken, nextToken.As<ColourLiteral>().value);
     }
 
-    throw SyntaxErrorException(program, programIndex, __LINE__);
+    ThrowSyntaxError(ProgramIndex(tokenIndex), __LINE__);
 }
 
-Scope<ASTReturnNode> Parser::ParseReturnStatement()
+ASTReturnNode* Parser::ParseReturnStatement()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Keyword, type == Keyword::Type::RETURN));
 
     auto expr = ParseExpression();
 
-    return CreateScope<ASTReturnNode>(std::move(expr));
+    return CreateNode<ASTReturnNode>(startToken, expr);
 }
 
-Scope<ASTFunctionNode> Parser::ParseFunctionDecl()
+ASTFunctionNode* Parser::ParseFunctionDecl()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Keyword, type == Keyword::Type::FUN));
 
     nextToken = GetNextToken();
-    ASSERT(nextToken->type == Token::Type::IDENTIFIER);
+    ASSERT(nextToken.type == Token::Type::IDENTIFIER);
 
-    std::string funName = nextToken->As<Identifier>().name;
+    SymbolID funName = Identifier(nextToken).symbol;
 
     nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::OPEN_PAREN));
 
-    std::vector<ASTFunctionNode::Param> params;
+    ASTFunctionNode::ParamList params(context->Resource());
 
     nextToken = PeekNextToken();
+    // Have to jump over the close bracket if the function has no parameters
+    if (CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::CLOSE_PAREN))
+        JumpToken();
+
     // Reads the function parameters
     while (!CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::CLOSE_PAREN))
     {
@@ -439,57 +502,206 @@ Scope<ASTFunctionNode> Parser::ParseFunctionDecl()
                CHECK_SUB_TYPE(nextToken, Punctuation, type == Punctuation::Type::COMMA));
     }
 
-    JumpToken(nextToken->lexemeLength);
-
     nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Punctuation, type == Punctuation::Type::ARROW));
 
     nextToken = GetNextToken();
-    ASSERT(nextToken->type == Token::Type::VAR_TYPE);
+    ASSERT(nextToken.type == Token::Type::VAR_TYPE);
 
-    auto retType = nextToken->As<VarType>().type;
+    auto retType = nextToken.As<VarType>().type;
 
     nextToken = PeekNextToken();
     int arraySize = -1;
     // If return type is an array
     if (CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::OPEN_SQ_BRACK))
     {
-        JumpToken(nextToken->lexemeLength);
+        JumpToken();
         nextToken = GetNextToken();
-        ASSERT(nextToken->type == Token::Type::INT_LITERAL);
-        arraySize = nextToken->As<IntegerLiteral>().value;
+        ASSERT(nextToken.type == Token::Type::INT_LITERAL);
+        arraySize = nextToken.As<IntegerLiteral>().value;
         nextToken = GetNextToken();
         ASSERT(CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::CLOSE_SQ_BRACK));
     }
 
+    if (lazyFunctionBodies)
+    {
+        int bodyToken = tokenIndex;
+        SkipBlock();
+
+        auto funcNode = CreateNode<ASTFunctionNode>(startToken, funName, std::move(params), retType, arraySize, nullptr);
+        funcNode->bodyParser = this;
+        funcNode->bodyToken = bodyToken;
+        return funcNode;
+    }
+
+    auto blockNode = ParseFunctionBlock();
+
+    return CreateNode<ASTFunctionNode>(startToken, funName, std::move(params), retType, arraySize, blockNode);
+}
+
+ASTBlockNode* Parser::ParseFunctionBlock()
+{
+    auto body = std::lower_bound(parsedBodies.begin(), parsedBodies.end(), tokenIndex,
+                                 [](const ParsedBody& body, int token) { return body.startToken < token; });
+    if (body == parsedBodies.end() || body->startToken != tokenIndex)
+        return ParseBlock();
+
+    if (body->syntaxError)
+    {
+        const DeferredSyntaxError& error = *body->syntaxError;
+        throw SyntaxErrorException(*source, error.character, error.codeLine, error.reason);
+    }
+    if (body->exception)
+        std::rethrow_exception(body->exception);
+
+    tokenIndex = body->endToken;
+    pastTokenIndex = tokenIndex - 1;
+#ifdef _DEBUG
+    consumedTokens = std::max(consumedTokens, tokenIndex);
+#endif
+    return body->blockNode;
+}
+
+std::vector<int> Parser::FindFunctionBodies() const
+{
+    std::vector<int> bodies;
+    int depth = 0;
+    bool inSignature = false;
+    for (int i = 0; i < (int)tokens.size(); i++)
+    {
+        const Token& token = tokens[i];
+        // Signatures have no braces, so the block starts at the first one after the name
+        if (depth == 0 && CHECK_SUB_TYPE(token, Keyword, type == Keyword::Type::FUN))
+        {
+            inSignature = true;
+        }
+        else if (CHECK_SUB_TYPE(token, Bracket, type == Bracket::Type::OPEN_CURLY_BRACK))
+        {
+            if (inSignature)
+                bodies.push_back(i);
+            inSignature = false;
+            depth++;
+        }
+        else if (CHECK_SUB_TYPE(token, Bracket, type == Bracket::Type::CLOSE_CURLY_BRACK))
+        {
+            depth = std::max(depth - 1, 0);
+        }
+    }
+
+    return bodies;
+}
+
+void Parser::ParseFunctionBodiesParallel(ThreadPool& pool)
+{
+    // The pool only has one thread on a single core, where this would just add overhead
+    if (pool.size() < 2)
+        return;
+
+    std::vector<int> bodies = FindFunctionBodies();
+    if (bodies.size() < 2)
+        return;
+
+    // A few chunks per thread even out uneven blocks. Each chunk allocates from a context
+    // of its own, and a body the parse does not reach, as in a malformed program, is unused
+    size_t numChunks = std::min(bodies.size(), (pool.size() + 1) * 4);
+    std::vector<ASTContext*> chunkContexts;
+    for (size_t i = 0; i < numChunks; i++)
+        chunkContexts.push_back(&context->CreateChild());
+
+    parsedBodies.resize(bodies.size());
+    pool.ParallelFor(numChunks, [&](size_t chunk)
+    {
+        Parser worker;
+        worker.deferSyntaxErrors = true;
+        worker.source = source;
+        worker.context = chunkContexts[chunk];
+        worker.tokens = tokens;
+
+        for (size_t i = chunk * bodies.size() / numChunks; i < (chunk + 1) * bodies.size() / numChunks; i++)
+        {
+            ParsedBody& body = parsedBodies[i];
+            body.startToken = bodies[i];
+            worker.tokenIndex = bodies[i];
+            try
+            {
+                body.blockNode = worker.ParseBlock();
+                body.endToken = worker.tokenIndex;
+            }
+            catch (const DeferredSyntaxError& error)
+            {
+                body.syntaxError = error;
+            }
+            catch (...)
+            {
+                body.exception = std::current_exception();
+            }
+        }
+    });
+}
+
+void Parser::ThrowSyntaxError(int character, int codeLine, std::string_view reason) const
+{
+    if (deferSyntaxErrors)
+        throw DeferredSyntaxError{ character, codeLine, reason };
+
+    throw SyntaxErrorException(*source, character, codeLine, reason);
+}
+
+ASTBlockNode* Parser::ParseFunctionBody(int startToken)
+{
+    int resumeToken = tokenIndex;
+    tokenIndex = startToken;
     auto blockNode = ParseBlock();
+    tokenIndex = resumeToken;
+
+    return blockNode;
+}
 
-    return CreateScope<ASTFunctionNode>(funName, params, retType, arraySize, std::move(blockNode));
+void Parser::SkipBlock()
+{
+    ASSERT(CHECK_SUB_TYPE(PeekNextToken(), Bracket, type == Bracket::Type::OPEN_CURLY_BRACK));
+
+    // Only brackets are looked at, the tokens are consumed when the block is parsed
+    int depth = 0;
+    do
+    {
+        pastTokenIndex = tokenIndex;
+        const Token& token = tokens[tokenIndex];
+        ASSERT(token.type != Token::Type::END_OF_FILE);
+
+        if (CHECK_SUB_TYPE(token, Bracket, type == Bracket::Type::OPEN_CURLY_BRACK))
+            depth++;
+        else if (CHECK_SUB_TYPE(token, Bracket, type == Bracket::Type::CLOSE_CURLY_BRACK))
+            depth--;
+        tokenIndex++;
+    } while (depth > 0);
 }
 
-Scope<ASTIdentifierNode> Parser::ParseIdentifier()
+ASTIdentifierNode* Parser::ParseIdentifier()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
-    ASSERT(nextToken->type == Token::Type::IDENTIFIER);
-    std::string identifierName = nextToken->As<Identifier>().name;
+    ASSERT(nextToken.type == Token::Type::IDENTIFIER);
+    SymbolID identifierName = Identifier(nextToken).symbol;
 
     nextToken = PeekNextToken();
     
     // If identifier is array indexing
     if (CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::OPEN_SQ_BRACK))
     {
-        JumpToken(nextToken->lexemeLength);
+        JumpToken();
         auto expr = ParseExpression();
         nextToken = GetNextToken();
         ASSERT(CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::CLOSE_SQ_BRACK));
-        return CreateScope<ASTArrayIndexNode>(identifierName, std::move(expr));
+        return CreateNode<ASTArrayIndexNode>(startToken, identifierName, expr);
     }
 
-    return CreateScope<ASTIdentifierNode>(identifierName);
+    return CreateNode<ASTIdentifierNode>(startToken, identifierName);
 }
 
-Scope<ASTWhileNode> Parser::ParseWhileLoop()
+ASTWhileNode* Parser::ParseWhileLoop()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Keyword, type == Keyword::Type::WHILE));
 
@@ -500,11 +712,12 @@ Scope<ASTWhileNode> Parser::ParseWhileLoop()
 
     auto blockNode = ParseBlock();
 
-    return CreateScope<ASTWhileNode>(std::move(expr), std::move(blockNode));
+    return CreateNode<ASTWhileNode>(startToken, expr, blockNode);
 }
 
-Scope<ASTForNode> Parser::ParseForLoop()
+ASTForNode* Parser::ParseForLoop()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Keyword, type == Keyword::Type::FOR));
 
@@ -512,7 +725,7 @@ Scope<ASTForNode> Parser::ParseForLoop()
     ASSERT(CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::OPEN_PAREN));
 
     nextToken = PeekNextToken();
-    Scope<ASTVarDeclNode> varDecl = nullptr;
+    ASTVarDeclNode* varDecl = nullptr;
     if (!CHECK_SUB_TYPE(nextToken, Punctuation, type == Punctuation::Type::SEMICOLON))
     {
         varDecl = ParseVariableDeclaration();
@@ -521,13 +734,13 @@ Scope<ASTForNode> Parser::ParseForLoop()
     nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Punctuation, type == Punctuation::Type::SEMICOLON));
 
-    Scope<ASTExpressionNode> expr = ParseExpression();
+    ASTExpressionNode* expr = ParseExpression();
 
     nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Punctuation, type == Punctuation::Type::SEMICOLON));
 
     nextToken = PeekNextToken();
-    Scope<ASTAssignmentNode> assignment = nullptr;
+    ASTAssignmentNode* assignment = nullptr;
     if (!CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::CLOSE_PAREN))
     {
         assignment = ParseAssignment();
@@ -538,27 +751,30 @@ Scope<ASTForNode> Parser::ParseForLoop()
 
     auto blockNode = ParseBlock();
 
-    return CreateScope<ASTForNode>(std::move(varDecl), std::move(expr), std::move(assignment), std::move(blockNode));
+    return CreateNode<ASTForNode>(startToken, varDecl, expr, assignment, blockNode);
 }
 
-Scope<ASTWidthNode> Parser::ParseWidth()
+ASTWidthNode* Parser::ParseWidth()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Builtin, type == Builtin::Type::WIDTH));
 
-    return CreateScope<ASTWidthNode>();
+    return CreateNode<ASTWidthNode>(startToken);
 }
 
-Scope<ASTHeightNode> Parser::ParseHeight()
+ASTHeightNode* Parser::ParseHeight()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Builtin, type == Builtin::Type::HEIGHT));
 
-    return CreateScope<ASTHeightNode>();
+    return CreateNode<ASTHeightNode>(startToken);
 }
 
-Scope<ASTReadNode> Parser::ParseRead()
+ASTReadNode* Parser::ParseRead()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Builtin, type == Builtin::Type::READ));
 
@@ -569,51 +785,56 @@ Scope<ASTReadNode> Parser::ParseRead()
 
     auto y = ParseExpression();
 
-    return CreateScope<ASTReadNode>(std::move(x), std::move(y));
+    return CreateNode<ASTReadNode>(startToken, x, y);
 }
 
-Scope<ASTClearNode> Parser::ParseClear()
+ASTClearNode* Parser::ParseClear()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Builtin, type == Builtin::Type::CLEAR));
 
     auto expr = ParseExpression();
 
-    return CreateScope<ASTClearNode>(std::move(expr));
+    return CreateNode<ASTClearNode>(startToken, expr);
 }
 
-Scope<ASTRandIntNode> Parser::ParseRandInt()
+ASTRandIntNode* Parser::ParseRandInt()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Builtin, type == Builtin::Type::RANDOM_INT));
 
     auto max = ParseExpression();
 
-    return CreateScope<ASTRandIntNode>(std::move(max));
+    return CreateNode<ASTRandIntNode>(startToken, max);
 }
 
-Scope<ASTPrintNode> Parser::ParsePrint()
+ASTPrintNode* Parser::ParsePrint()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Builtin, type == Builtin::Type::PRINT));
 
     auto expr = ParseExpression();
 
-    return CreateScope<ASTPrintNode>(std::move(expr));
+    return CreateNode<ASTPrintNode>(startToken, expr);
 }
 
-Scope<ASTDelayNode> Parser::ParseDelay()
+ASTDelayNode* Parser::ParseDelay()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Builtin, type == Builtin::Type::DELAY));
 
     auto expr = ParseExpression();
 
-    return CreateScope<ASTDelayNode>(std::move(expr));
+    return CreateNode<ASTDelayNode>(startToken, expr);
 }
 
-Scope<ASTWriteNode> Parser::ParseWrite()
+ASTWriteNode* Parser::ParseWrite()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Builtin, type == Builtin::Type::WRITE));
 
@@ -629,11 +850,12 @@ Scope<ASTWriteNode> Parser::ParseWrite()
 
     auto colour = ParseExpression();
 
-    return CreateScope<ASTWriteNode>(std::move(x), std::move(y), std::move(colour));
+    return CreateNode<ASTWriteNode>(startToken, x, y, colour);
 }
 
-Scope<ASTWriteBoxNode> Parser::ParseWriteBox()
+ASTWriteBoxNode* Parser::ParseWriteBox()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Builtin, type == Builtin::Type::WRITE_BOX));
 
@@ -659,15 +881,16 @@ Scope<ASTWriteBoxNode> Parser::ParseWriteBox()
 
     auto colour = ParseExpression();
 
-    return CreateScope<ASTWriteBoxNode>(std::move(x), std::move(y), std::move(w), std::move(h), std::move(colour));
+    return CreateNode<ASTWriteBoxNode>(startToken, x, y, w, h, colour);
 }
 
-Scope<ASTFuncCallNode> Parser::ParseFunctionCall()
+ASTFuncCallNode* Parser::ParseFunctionCall()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
-    ASSERT(nextToken->type == Token::Type::IDENTIFIER);
+    ASSERT(nextToken.type == Token::Type::IDENTIFIER);
 
-    Scope<ASTFuncCallNode> funcCall = CreateScope<ASTFuncCallNode>(nextToken->As<Identifier>().name);
+    ASTFuncCallNode* funcCall = CreateNode<ASTFuncCallNode>(startToken, Identifier(nextToken).symbol, context->Resource());
 
     nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::OPEN_PAREN));
@@ -675,13 +898,13 @@ Scope<ASTFuncCallNode> Parser::ParseFunctionCall()
     nextToken = PeekNextToken();
     // Have to jump over the current token if the function call has no arguments
     if (CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::CLOSE_PAREN)) {
-        JumpToken(nextToken->lexemeLength);
+        JumpToken();
         return funcCall;
     }
 
     while (!CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::CLOSE_PAREN))
     {
-        funcCall->AddArg(std::move(ParseExpression()));
+        funcCall->AddArg(ParseExpression());
         nextToken = GetNextToken();
         ASSERT(CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::CLOSE_PAREN) ||
                CHECK_SUB_TYPE(nextToken, Punctuation, type == Punctuation::Type::COMMA));
@@ -695,25 +918,25 @@ ASTFunctionNode::Param Parser::ParseParam()
     ASTFunctionNode::Param param{};
 
     auto nextToken = GetNextToken();
-    ASSERT(nextToken->type == Token::Type::IDENTIFIER);
-    param.Name = nextToken->As<Identifier>().name;
+    ASSERT(nextToken.type == Token::Type::IDENTIFIER);
+    param.Name = Identifier(nextToken).symbol;
 
     nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Punctuation, type == Punctuation::Type::COLON));
 
     nextToken = GetNextToken();
-    ASSERT(nextToken->type == Token::Type::VAR_TYPE);
+    ASSERT(nextToken.type == Token::Type::VAR_TYPE);
 
-    param.Type = nextToken->As<VarType>().type;
+    param.Type = nextToken.As<VarType>().type;
 
     nextToken = PeekNextToken();
     // If the parameter is an array
     if (CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::OPEN_SQ_BRACK))
     {
-        JumpToken(nextToken->lexemeLength);
+        JumpToken();
         nextToken = GetNextToken();
-        ASSERT(nextToken->type == Token::Type::INT_LITERAL);
-        param.ArraySize = nextToken->As<IntegerLiteral>().value;
+        ASSERT(nextToken.type == Token::Type::INT_LITERAL);
+        param.ArraySize = nextToken.As<IntegerLiteral>().value;
         nextToken = GetNextToken();
         ASSERT(CHECK_SUB_TYPE(nextToken, Bracket, type == Bracket::Type::CLOSE_SQ_BRACK));
     }
@@ -721,8 +944,9 @@ ASTFunctionNode::Param Parser::ParseParam()
     return param;
 }
 
-Scope<ASTDecisionNode> Parser::ParseIfStatement()
+ASTDecisionNode* Parser::ParseIfStatement()
 {
+    int startToken = tokenIndex;
     auto nextToken = GetNextToken();
     ASSERT(CHECK_SUB_TYPE(nextToken, Keyword, type == Keyword::Type::IF));
 
@@ -733,15 +957,15 @@ Scope<ASTDecisionNode> Parser::ParseIfStatement()
 
     auto trueBlock = ParseBlock();
 
-    Scope<ASTBlockNode> falseBlock = nullptr;
+    ASTBlockNode* falseBlock = nullptr;
 
     nextToken = PeekNextToken();
 
     if (CHECK_SUB_TYPE(nextToken, Keyword, type == Keyword::Type::ELSE))
     {
-        JumpToken(nextToken->lexemeLength);
+        JumpToken();
         falseBlock = ParseBlock();
     }
 
-    return CreateScope<ASTDecisionNode>(std::move(expr), std::move(trueBlock), std::move(falseBlock));
+    return CreateNode<ASTDecisionNode>(startToken, expr, trueBlock, falseBlock);
 }
@@ -1,10 +1,19 @@
 #pragma once
 #include <string>
+#include <string_view>
+#include <sstream>
 #include <algorithm>
+#include <vector>
+#include <span>
+#include <exception>
+#include <optional>
 
 #include "../Lexer/Lexer.h"
 #include "ASTNodes.h"
+#include "ASTContext.h"
 #include "Utils/Utils.h"
+#include "Utils/SourceBuffer.h"
+#include "Utils/StackGuard.h"
 
 class Parser
 {
@@ -12,15 +21,14 @@ public:
     class SyntaxErrorException : public std::exception
     {
     public:
-        SyntaxErrorException(const std::string& program, int character, int codeLine)
+        SyntaxErrorException(const SourceBuffer& source, int character, int codeLine, std::string_view reason = {})
         {
-            std::string programUpToChar = program.substr(0, std::max(character, 0));
-            int lineCount = std::ranges::count(programUpToChar, '\n') + 1;
-            int lastLine = programUpToChar.rfind('\n');
-            int charCount = character - lastLine;
+            auto location = source.GetLocation(std::max(character, 0));
 
             std::ostringstream oss;
-            oss << "Syntax error at line " << lineCount << " character " << charCount;
+            oss << "Syntax error at line " << location.line << " character " << location.column;
+            if (!reason.empty())
+                oss << ": " << reason;
             message = oss.str();
         }
     public:
@@ -32,61 +40,157 @@ public:
         std::string message;
     };
 public:
-    Parser();
-    
-    Scope<ASTProgramNode> Parse(const std::string& program);
+    // With lazy function bodies, the parser only skims the block of each function and
+    // parses it the first time ASTFunctionNode::Body is called. The parser then has to
+    // outlive the AST and must not start another parse while the AST is in use
+    Parser(bool lazyFunctionBodies = false);
+
+    // The program is not copied, so it must outlive the parser. The nodes are allocated
+    // from the context and are freed with it
+    ASTProgramNode* Parse(const SourceBuffer& source, ASTContext& context);
+    ASTProgramNode* Parse(std::string_view program, ASTContext& context);
+    // Parses tokens already lexed from the source, such as the ones kept up to date by Lexer::Relex
+    ASTProgramNode* Parse(const SourceBuffer& source, std::vector<Token> tokens, ASTContext& context);
+
+    // Programs with at least this many tokens parse the blocks of their functions in parallel
+    static constexpr size_t PARALLEL_TOKENS = 64 * 1024;
+
+#ifdef _DEBUG
+    // Times a token was consumed again after the parser moved past it, always 0 for an LL(2) parse
+    inline int RewindCount() const { return rewinds; }
+#endif
 private:
-    Scope<ASTBlockNode> ParseBlock(bool root = false);
-    Scope<ASTNode> ParseStatement();
-    Scope<ASTVarDeclNode> ParseVariableDeclaration();
+    ASTBlockNode* ParseBlock(bool root = false);
+    ASTNode* ParseStatement();
+    ASTVarDeclNode* ParseVariableDeclaration();
 
-    Scope<ASTAssignmentNode> ParseAssignment();
+    ASTAssignmentNode* ParseAssignment();
 
-    Scope<ASTExpressionNode> ParseExpression(bool subExpr = false);
-    Scope<ASTExpressionNode> ParseSimpleExpression();
-    Scope<ASTExpressionNode> ParseTerm();
-    Scope<ASTExpressionNode> ParseFactor();
-    Scope<ASTExpressionNode> ParseLiteral();
+    ASTExpressionNode* ParseExpression(bool subExpr = false);
+    // Parses binary operators that bind at least as tightly as minPower by precedence climbing
+    ASTExpressionNode* ParseBinaryExpression(int minPower);
+    ASTExpressionNode* ParseFactor();
+    ASTExpressionNode* ParseLiteral();
 
-    Scope<ASTReturnNode> ParseReturnStatement();
+    ASTReturnNode* ParseReturnStatement();
 
-    Scope<ASTFunctionNode> ParseFunctionDecl();
+    ASTFunctionNode* ParseFunctionDecl();
+    ASTBlockNode* ParseFunctionBody(int startToken);
+    // Parses the block at the current token, or takes it from the ones parsed in parallel
+    ASTBlockNode* ParseFunctionBlock();
+    // Tokens the blocks of top-level functions start at, found by matching braces
+    std::vector<int> FindFunctionBodies() const;
+    // Parses the blocks of top-level functions on the pool before the rest of the program
+    void ParseFunctionBodiesParallel(ThreadPool& pool);
+    // Moves past a brace balanced block without building it
+    void SkipBlock();
 
-    Scope<ASTIdentifierNode> ParseIdentifier();
+    ASTIdentifierNode* ParseIdentifier();
 
-    Scope<ASTWhileNode> ParseWhileLoop();
-    Scope<ASTForNode> ParseForLoop();
+    ASTWhileNode* ParseWhileLoop();
+    ASTForNode* ParseForLoop();
 
-    Scope<ASTWidthNode> ParseWidth();
-    Scope<ASTHeightNode> ParseHeight();
-    Scope<ASTReadNode> ParseRead();
-    Scope<ASTClearNode> ParseClear();
-    Scope<ASTRandIntNode> ParseRandInt();
+    ASTWidthNode* ParseWidth();
+    ASTHeightNode* ParseHeight();
+    ASTReadNode* ParseRead();
+    ASTClearNode* ParseClear();
+    ASTRandIntNode* ParseRandInt();
 
-    Scope<ASTPrintNode> ParsePrint();
-    Scope<ASTDelayNode> ParseDelay();
-    Scope<ASTWriteNode> ParseWrite();
-    Scope<ASTWriteBoxNode> ParseWriteBox();
+    ASTPrintNode* ParsePrint();
+    ASTDelayNode* ParseDelay();
+    ASTWriteNode* ParseWrite();
+    ASTWriteBoxNode* ParseWriteBox();
 
-    Scope<ASTFuncCallNode> ParseFunctionCall();
+    ASTFuncCallNode* ParseFunctionCall();
 
     ASTFunctionNode::Param ParseParam();
 
-    Scope<ASTDecisionNode> ParseIfStatement();
+    ASTDecisionNode* ParseIfStatement();
 
-    inline Scope<Token> GetNextToken() { pastProgramIndex = programIndex; return lexer.GetNextToken(program, programIndex, true, true); }
-    inline Scope<Token> PeekNextToken() { return lexer.PeekNextToken(program, programIndex, true, true); }
-    inline void JumpToken(int tokenLength) { pastProgramIndex = programIndex; programIndex += tokenLength; }
-    inline void UndoToken(int startIndex) { programIndex = startIndex; pastProgramIndex = programIndex; }
+    inline const Token& GetNextToken()
+    {
+#ifdef _DEBUG
+        // Every token is consumed once, so coming back to an earlier one is a rewind
+        if (tokenIndex < consumedTokens)
+            rewinds++;
+        consumedTokens = std::max(consumedTokens, tokenIndex + 1);
+#endif
+        pastTokenIndex = tokenIndex;
+        const Token& token = tokens[tokenIndex];
+        // Literals the lexer could not decode are reported with the reason
+        if (token.type == Token::Type::ERROR && token.subType != (uint8_t)Error::Type::INVALID)
+            ThrowSyntaxError(token.startIndex, __LINE__, token.As<Error>().Reason());
+        if (token.type != Token::Type::END_OF_FILE)
+            tokenIndex++;
+        return token;
+    }
+    // Looks ahead without consuming, offset 1 is the token after the next one. Past the end this is END_OF_FILE
+    inline const Token& PeekNextToken(int offset = 0) const
+    {
+        return tokens[std::min(tokenIndex + offset, (int)tokens.size() - 1)];
+    }
+    inline void JumpToken() { GetNextToken(); }
+
+    // Index in the program of the token at the given index, used for error messages
+    inline int ProgramIndex(int index) const { return tokens[index].startIndex; }
+
+    // Throws a SyntaxErrorException, or a DeferredSyntaxError from a parser working on the pool
+    [[noreturn]] void ThrowSyntaxError(int character, int codeLine, std::string_view reason = {}) const;
+
+    // Creates a node that starts at the token at the given index, so later stages can report where it is
+    template<typename T, typename ... Args>
+    inline T* CreateNode(int startToken, Args&& ... args)
+    {
+        T* node = context->Create<T>(std::forward<Args>(args)...);
+        node->sourceIndex = ProgramIndex(startToken);
+        return node;
+    }
 private:
+    friend class ASTFunctionNode;
+
+    // Syntax error found by a parser working on the pool. Building the exception finds the
+    // line of the character, which indexes the source, so it is left to the calling thread
+    struct DeferredSyntaxError
+    {
+        int character = 0;
+        int codeLine = 0;
+        std::string_view reason{};
+    };
+
+    // Block of a top-level function parsed ahead by another thread
+    struct ParsedBody
+    {
+        int startToken = 0;
+        int endToken = 0;
+        ASTBlockNode* blockNode = nullptr;
+        // Thrown once the parse reaches the function, so errors are still reported in order
+        std::optional<DeferredSyntaxError> syntaxError;
+        std::exception_ptr exception = nullptr;
+    };
+
     Lexer lexer{};
-    std::string program;
-    int programIndex = 0;
-    // Used for debugging
-    int pastProgramIndex = 0;
+    bool lazyFunctionBodies = false;
+    // Set on the parsers working on the pool
+    bool deferSyntaxErrors = false;
+    const SourceBuffer* source = nullptr;
+    ASTContext* context = nullptr;
+    // Wraps programs passed as a string_view
+    SourceBuffer wrappedSource{};
+    std::vector<Token> tokenStorage;
+    // Parsers working on function blocks in parallel share the tokens of the main one
+    std::span<const Token> tokens;
+    int tokenIndex = 0;
+    // Last token consumed, used for error positions
+    int pastTokenIndex = 0;
+    // Sorted by start token
+    std::vector<ParsedBody> parsedBodies;
+#ifdef _DEBUG
+    int consumedTokens = 0;
+    int rewinds = 0;
+#endif
 };
 
 // Checks that the given type is of the correct type and satisfies a condition
-#define CHECK_SUB_TYPE(var, cls, check) (var->type == ::Tokens::cls::TokenType && var->As<::Tokens::cls>().check)
+#define CHECK_SUB_TYPE(var, cls, check) (var.type == ::Tokens::cls::TokenType && var.As<::Tokens::cls>().check)
 // Asserts and throws a syntax error on fail
-#define ASSERT(condition) if(!(condition)) { throw SyntaxErrorException(program, pastProgramIndex, __LINE__); }
\ No newline at end of file
+#define ASSERT(condition) if(!(condition)) { ThrowSyntaxError(ProgramIndex(pastTokenIndex), __LINE__); }
\ No newline at end of file
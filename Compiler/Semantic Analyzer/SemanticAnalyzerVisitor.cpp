@@ -7,17 +7,31 @@ void SemanticAnalyzerVisitor::visit(ASTBlockNode& node)
     // This allows function calls to be made before the function is defined
     for (auto& statement : node.statements)
     {
-        ASTFunctionNode* funcNode = dynamic_cast<ASTFunctionNode*>(statement.get());
+        ASTFunctionNode* funcNode = statement->As<ASTFunctionNode>();
         if (funcNode)
         {
             symbolTable.AddEntry(funcNode->name, Entry(funcNode->returnType, funcNode->returnSize, funcNode->params));
+            if (!funcNode->IsParsed() && symbolTable.InRootScope())
+                unreachedFunctions[funcNode->name] = funcNode;
         }
     }
 
     for (auto& statement : node.statements)
     {
+        ASTFunctionNode* funcNode = statement->As<ASTFunctionNode>();
+        if (funcNode && !funcNode->IsParsed() && symbolTable.InRootScope())
+            continue;
+
         statement->accept(*this);
     }
+
+    // Calls in the functions analyzed here can reach further functions
+    while (symbolTable.InRootScope() && !reachedFunctions.empty())
+    {
+        ASTFunctionNode* funcNode = reachedFunctions.back();
+        reachedFunctions.pop_back();
+        funcNode->accept(*this);
+    }
     symbolTable.PopScope();
 }
 
@@ -48,7 +62,7 @@ void SemanticAnalyzerVisitor::visit(ASTColourLiteralNode& node)
 
 void SemanticAnalyzerVisitor::visit(ASTIdentifierNode& node)
 {
-    ASSERT(symbolTable.contains(node.name), "Unidentified identifier \'" + node.name + "\'");
+    ASSERT(symbolTable.contains(node.name), "Unidentified identifier \'" + SymbolName(node.name) + "\'");
     auto& entry = symbolTable[node.name];
     PushType(entry.type, entry.arraySize);
 }
@@ -166,32 +180,35 @@ void SemanticAnalyzerVisitor::visit(ASTReturnNode& node)
 // or if a return is defined in both the if and else statement
 static bool HasReturnNode(ASTBlockNode* blockNode) 
 {
-    for (auto& statement : blockNode->statements)
+    return StackGuard::Call([&]()
     {
-        if (dynamic_cast<ASTReturnNode*>(statement.get()))
-            return true;
-
-        if (auto decisionNode = dynamic_cast<ASTDecisionNode*>(statement.get()))
+        for (auto& statement : blockNode->statements)
         {
-            if (decisionNode->falseStatement && 
-                HasReturnNode(decisionNode->trueStatement.get()) &&
-                HasReturnNode(decisionNode->falseStatement.get()))
-            {
+            if (statement->kind == NodeKind::RETURN)
                 return true;
+
+            if (auto decisionNode = statement->As<ASTDecisionNode>())
+            {
+                if (decisionNode->falseStatement && 
+                    HasReturnNode(decisionNode->trueStatement) &&
+                    HasReturnNode(decisionNode->falseStatement))
+                {
+                    return true;
+                }
             }
         }
-    }
 
-    return false;
+        return false;
+    });
 }
 
 void SemanticAnalyzerVisitor::visit(ASTFunctionNode& node)
 {
     ASSERT(symbolTable.InRootScope(), "Cannot declare functions inside a scope");
-    ASSERT(node.name != "main", "Cannot call function 'main'");
+    ASSERT(node.name != mainSymbol, "Cannot call function 'main'");
 
     auto funcEntry = symbolTable[node.name];
-    ASSERT(funcEntry.IsFunction(), node.name + " is not a function");
+    ASSERT(funcEntry.IsFunction(), SymbolName(node.name) + " is not a function");
 
     symbolTable.PushScope(true);
     expectedRetType = node.returnType;
@@ -202,9 +219,9 @@ void SemanticAnalyzerVisitor::visit(ASTFunctionNode& node)
         symbolTable.AddEntry(param.Name, Entry(param.Type, param.ArraySize));
     }
 
-    node.blockNode->accept(*this);
+    node.Body()->accept(*this);
 
-    ASSERT(HasReturnNode(node.blockNode.get()), "No definite return was found. Make sure you return in the outer scope");
+    ASSERT(HasReturnNode(node.blockNode), "No definite return was found. Make sure you return in the outer scope");
 
     expectedRetType = VarType::Type::UNKNOWN;
     expectedRetArrSize = -1;
@@ -325,9 +342,17 @@ void SemanticAnalyzerVisitor::visit(ASTRandIntNode& node)
 
 void SemanticAnalyzerVisitor::visit(ASTFuncCallNode& node)
 {
-    ASSERT(symbolTable.contains(node.funcName), "\'" + node.funcName + "\' is not defined");
+    ASSERT(symbolTable.contains(node.funcName), "\'" + SymbolName(node.funcName) + "\' is not defined");
+
+    // Copied, as visiting the arguments can move the entries of the symbol table
+    auto entry = symbolTable[node.funcName];
+    ASSERT(entry.IsFunction(), "\'" + SymbolName(node.funcName) + "\' is not a function");
+    if (auto it = unreachedFunctions.find(node.funcName); it != unreachedFunctions.end())
+    {
+        reachedFunctions.push_back(it->second);
+        unreachedFunctions.erase(it);
+    }
 
-    auto& entry = symbolTable[node.funcName];
     ASSERT(node.args.size() == entry.funcData->params.size(), "Invalid number of arguments. Number of arguments passed: " + std::to_string(node.args.size()) + ", Number of arguments expected: " + std::to_string(entry.funcData->params.size()));
 
     auto funcIt = entry.funcData->params.begin();
@@ -364,7 +389,7 @@ void SemanticAnalyzerVisitor::visit(ASTArraySetNode& node)
 
 void SemanticAnalyzerVisitor::visit(ASTArrayIndexNode& node)
 {
-    ASSERT(symbolTable.contains(node.name), "\'" + node.name + "\' is not defined");
+    ASSERT(symbolTable.contains(node.name), "\'" + SymbolName(node.name) + "\' is not defined");
     auto& entry = symbolTable[node.name];
     PushType(entry.type);
 }
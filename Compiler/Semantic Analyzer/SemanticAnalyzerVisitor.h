@@ -1,11 +1,14 @@
 #pragma once
 #include <vector>
+#include <unordered_map>
 #include <tuple>
+#include <sstream>
 
 #include "../Utils/Visitor.h"
 #include "../Utils/SymbolTable.h"
 #include "../Lexer/Tokens.h"
 #include "../Parser/ASTNodes.h"
+#include "../Utils/SourceBuffer.h"
 
 using namespace Tokens;
 using Type = std::pair<Tokens::VarType::Type, int>;
@@ -20,6 +23,15 @@ public:
         msg = oss.str();
     }
 
+    SemanticErrorException(const std::string& line, const SourceBuffer& source, uint32_t sourceIndex)
+    {
+        auto location = source.GetLocation(sourceIndex);
+
+        std::ostringstream oss;
+        oss << "Semantic error at line " << location.line << " character " << location.column << ": " << line;
+        msg = oss.str();
+    }
+
     const char* what()
     {
         return msg.c_str();
@@ -28,7 +40,7 @@ public:
     std::string msg;
 };
 
-class SemanticAnalyzerVisitor : public Visitor
+class SemanticAnalyzerVisitor final : public Visitor
 {
 public:
     struct Entry
@@ -37,8 +49,8 @@ public:
         {
             FuncData() = default;
 
-            FuncData(const std::vector<ASTFunctionNode::Param>& params)
-                : params(params)
+            FuncData(const ASTFunctionNode::ParamList& params)
+                : params(params.begin(), params.end())
             {
 
             }
@@ -52,7 +64,7 @@ public:
             : type(Tokens::VarType::Type::UNKNOWN), funcData(nullptr)
         {}
 
-        Entry(const Tokens::VarType::Type& type, int arraySize, const std::vector<ASTFunctionNode::Param>& params)
+        Entry(const Tokens::VarType::Type& type, int arraySize, const ASTFunctionNode::ParamList& params)
             : type(type), arraySize(arraySize)
         {
             funcData = CreateRef<FuncData>(params);
@@ -78,6 +90,13 @@ public:
         Ref<FuncData> funcData = nullptr;
     };
 public:
+    SemanticAnalyzerVisitor() = default;
+
+    // Errors report the line and character of the node they are about
+    SemanticAnalyzerVisitor(const SourceBuffer& source)
+        : source(&source)
+    {}
+
     void visit(ASTBlockNode& node) override;
     void visit(ASTProgramNode& node) override;
     void visit(ASTIntLiteralNode& node) override;
@@ -105,6 +124,9 @@ public:
     void visit(ASTReadNode& node) override;
     void visit(ASTRandIntNode& node) override;
     void visit(ASTFuncCallNode& node) override;
+    void visit(ASTArraySetNode& node) override;
+    void visit(ASTArrayIndexNode& node) override;
+    void visit(ASTClearNode& node) override;
 
 private:
     inline void PushType(VarType::Type type, int arraySize = -1) { typeStack.emplace_back(type, arraySize); }
@@ -116,6 +138,9 @@ private:
         return type;
     }
 
+    // Names are only turned back into text for error messages
+    inline static std::string SymbolName(SymbolID name) { return std::string(StringInterner::Global()[name]); }
+
     inline std::tuple<Type, Type> PopTypes()
     {
         auto type1 = PopType();
@@ -125,20 +150,18 @@ private:
     }
 
 private:
+    const SourceBuffer* source = nullptr;
     SymbolTable<Entry> symbolTable{};
     std::vector<Type> typeStack{};
     VarType::Type expectedRetType = VarType::Type::UNKNOWN;
     int expectedRetArrSize = -1;
-
-    // Inherited via Visitor
-    void visit(ASTArraySetNode& node) override;
-
-    // Inherited via Visitor
-    void visit(ASTArrayIndexNode& node) override;
-
-    // Inherited via Visitor
-    void visit(ASTClearNode& node) override;
+    const SymbolID mainSymbol = StringInterner::Global().Intern("main");
+    // Functions whose bodies a lazy parse skipped are only analyzed once a call reaches them,
+    // after the rest of the root block. Functions cannot see variables outside their scope,
+    // so this gives the same result as analyzing them in place
+    std::unordered_map<SymbolID, ASTFunctionNode*> unreachedFunctions;
+    std::vector<ASTFunctionNode*> reachedFunctions;
 };
 
-#define ASSERT(check, message) if(!(check)) { throw SemanticErrorException(message); }
+#define ASSERT(check, message) if(!(check)) { throw source ? SemanticErrorException(message, *source, node.sourceIndex) : SemanticErrorException(message); }
 #define IS_ARRAY(type) (type.second > 0)
\ No newline at end of file
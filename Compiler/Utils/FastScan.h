@@ -0,0 +1,147 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FAST_SCAN_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FAST_SCAN_SSE2
+#endif
+
+// Scans over source text that skip many bytes at once, used for comments
+// and whitespace. Uses AVX2 or SSE2 when the target supports them and falls
+// back to a byte at a time loop otherwise
+namespace FastScan
+{
+    // Finds the first c in [begin, end). Returns end if there is none
+    inline const char* FindByte(const char* begin, const char* end, char c)
+    {
+        const char* p = begin;
+
+#ifdef FAST_SCAN_AVX2
+        const __m256i target32 = _mm256_set1_epi8(c);
+        for (; end - p >= 32; p += 32)
+        {
+            __m256i chunk = _mm256_loadu_si256((const __m256i*)p);
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, target32));
+            if (mask)
+                return p + std::countr_zero(mask);
+        }
+#endif
+
+#ifdef FAST_SCAN_SSE2
+        const __m128i target16 = _mm_set1_epi8(c);
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, target16));
+            if (mask)
+                return p + std::countr_zero(mask);
+        }
+#endif
+
+        for (; p < end; p++)
+        {
+            if (*p == c)
+                return p;
+        }
+
+        return end;
+    }
+
+    // Finds the first a that is directly followed by b in [begin, end).
+    // Returns end if there is none
+    inline const char* FindPair(const char* begin, const char* end, char a, char b)
+    {
+        const char* p = begin;
+
+#ifdef FAST_SCAN_AVX2
+        const __m256i firstTarget32 = _mm256_set1_epi8(a);
+        const __m256i secondTarget32 = _mm256_set1_epi8(b);
+        // The second load reads one byte ahead
+        for (; end - p >= 33; p += 32)
+        {
+            __m256i first = _mm256_loadu_si256((const __m256i*)p);
+            __m256i second = _mm256_loadu_si256((const __m256i*)(p + 1));
+            __m256i matches = _mm256_and_si256(_mm256_cmpeq_epi8(first, firstTarget32), _mm256_cmpeq_epi8(second, secondTarget32));
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(matches);
+            if (mask)
+                return p + std::countr_zero(mask);
+        }
+#endif
+
+#ifdef FAST_SCAN_SSE2
+        const __m128i firstTarget16 = _mm_set1_epi8(a);
+        const __m128i secondTarget16 = _mm_set1_epi8(b);
+        for (; end - p >= 17; p += 16)
+        {
+            __m128i first = _mm_loadu_si128((const __m128i*)p);
+            __m128i second = _mm_loadu_si128((const __m128i*)(p + 1));
+            __m128i matches = _mm_and_si128(_mm_cmpeq_epi8(first, firstTarget16), _mm_cmpeq_epi8(second, secondTarget16));
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(matches);
+            if (mask)
+                return p + std::countr_zero(mask);
+        }
+#endif
+
+        for (; end - p >= 2; p++)
+        {
+            if (p[0] == a && p[1] == b)
+                return p;
+        }
+
+        return end;
+    }
+
+    // Skips spaces, tabs, newlines, carriage returns, vertical tabs and form feeds.
+    // Returns the first other character in [begin, end) or end if there is none
+    inline const char* SkipWhitespace(const char* begin, const char* end)
+    {
+        const char* p = begin;
+
+#ifdef FAST_SCAN_AVX2
+        const __m256i space32 = _mm256_set1_epi8(' ');
+        const __m256i tab32 = _mm256_set1_epi8('\t');
+        const __m256i controlRange32 = _mm256_set1_epi8('\r' - '\t');
+        for (; end - p >= 32; p += 32)
+        {
+            __m256i chunk = _mm256_loadu_si256((const __m256i*)p);
+            // '\t' to '\r' are contiguous, so they are matched with one unsigned range check
+            __m256i offset = _mm256_sub_epi8(chunk, tab32);
+            __m256i isControl = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, controlRange32), offset);
+            __m256i isWhitespace = _mm256_or_si256(isControl, _mm256_cmpeq_epi8(chunk, space32));
+            uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(isWhitespace);
+            if (mask)
+                return p + std::countr_zero(mask);
+        }
+#endif
+
+#ifdef FAST_SCAN_SSE2
+        const __m128i space16 = _mm_set1_epi8(' ');
+        const __m128i tab16 = _mm_set1_epi8('\t');
+        const __m128i controlRange16 = _mm_set1_epi8('\r' - '\t');
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+            __m128i offset = _mm_sub_epi8(chunk, tab16);
+            __m128i isControl = _mm_cmpeq_epi8(_mm_min_epu8(offset, controlRange16), offset);
+            __m128i isWhitespace = _mm_or_si128(isControl, _mm_cmpeq_epi8(chunk, space16));
+            uint32_t mask = ~(uint32_t)_mm_movemask_epi8(isWhitespace) & 0xFFFF;
+            if (mask)
+                return p + std::countr_zero(mask);
+        }
+#endif
+
+        for (; p < end; p++)
+        {
+            if (*p != ' ' && (unsigned char)(*p - '\t') > '\r' - '\t')
+                return p;
+        }
+
+        return end;
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <array>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+// Collision free hash table over a fixed set of strings, built at compile time.
+// A lookup hashes the length and three characters of the string and then does a
+// single compare against the only key that can match
+template<size_t N>
+class PerfectHash
+{
+    static_assert(N > 0 && N < 128, "Slots store key positions as int8_t");
+
+public:
+    constexpr PerfectHash(const std::array<std::string_view, N>& keys)
+        : keys(keys)
+    {
+        for (seed = 0; seed < MAX_SEED; seed++)
+        {
+            if (TryBuild())
+                return;
+        }
+
+        // Fails compilation when the table is built in a constant expression
+        throw "No collision free seed found, add more characters to the hash";
+    }
+
+    // Returns the position of str in the keys, or -1 if it is not one of them
+    constexpr int Find(std::string_view str) const
+    {
+        if (str.empty())
+            return -1;
+
+        int index = slots[Hash(str, seed)];
+        return index != -1 && keys[index] == str ? index : -1;
+    }
+
+private:
+    static constexpr uint32_t CalculateTableBits()
+    {
+        uint32_t bits = 1;
+        while ((size_t(1) << bits) < N * 2)
+            bits++;
+        return bits;
+    }
+
+    static constexpr uint32_t Hash(std::string_view str, uint32_t seed)
+    {
+        // Packs the length and three characters, then does a multiplicative hash
+        // with a multiplier picked by the seed
+        uint32_t key = (uint32_t)(str.length() & 0xFF) |
+            (uint32_t)(unsigned char)str[0] << 8 |
+            (uint32_t)(unsigned char)str[str.length() / 2] << 16 |
+            (uint32_t)(unsigned char)str[str.length() - 1] << 24;
+        uint32_t multiplier = (seed * 0x9E3779B9u + 0x7F4A7C15u) | 1;
+        // The top bits are the best mixed
+        return (key * multiplier) >> (32 - TABLE_BITS);
+    }
+
+    constexpr bool TryBuild()
+    {
+        slots.fill(-1);
+        for (size_t i = 0; i < N; i++)
+        {
+            uint32_t slot = Hash(keys[i], seed);
+            if (slots[slot] != -1)
+                return false;
+
+            slots[slot] = (int8_t)i;
+        }
+
+        return true;
+    }
+
+private:
+    static constexpr uint32_t TABLE_BITS = CalculateTableBits();
+    static constexpr uint32_t MAX_SEED = 1 << 12;
+
+    std::array<std::string_view, N> keys{};
+    std::array<int8_t, size_t(1) << TABLE_BITS> slots{};
+    uint32_t seed = 0;
+};
@@ -0,0 +1,111 @@
+#pragma once
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <new>
+#include <cstring>
+#include <cstdint>
+
+// Vector that keeps its first N elements inside the object itself and only allocates,
+// from the given memory resource, once it grows past them. Meant for the lists held by
+// AST nodes, whose destructors are never run, so elements must be trivially copyable
+// and the memory is left for the resource to release
+template<typename T, uint32_t N>
+class SmallVector
+{
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>);
+    static_assert(N > 0);
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reverse_iterator = std::reverse_iterator<T*>;
+    using const_reverse_iterator = std::reverse_iterator<const T*>;
+
+    SmallVector(std::pmr::memory_resource* resource)
+        : resource(resource)
+    {}
+
+    SmallVector(const SmallVector&) = delete;
+    SmallVector& operator=(const SmallVector&) = delete;
+
+    // Takes over a list that has spilled into the resource, otherwise copies the inline elements
+    SmallVector(SmallVector&& other) noexcept
+        : resource(other.resource), count(other.count)
+    {
+        if (other.IsInline())
+        {
+            memcpy(storage, other.storage, count * sizeof(T));
+        }
+        else
+        {
+            elements = other.elements;
+            capacity = other.capacity;
+        }
+
+        other.elements = (T*)other.storage;
+        other.count = 0;
+        other.capacity = N;
+    }
+
+    inline void push_back(const T& value)
+    {
+        if (count == capacity)
+            Grow(capacity * 2);
+        elements[count++] = value;
+    }
+
+    template<typename ... Args>
+    inline T& emplace_back(Args&& ... args)
+    {
+        if (count == capacity)
+            Grow(capacity * 2);
+        return *new (elements + count++) T(std::forward<Args>(args)...);
+    }
+
+    inline void reserve(size_t newCapacity)
+    {
+        if (newCapacity > capacity)
+            Grow((uint32_t)newCapacity);
+    }
+
+    inline T& operator[](size_t index) { return elements[index]; }
+    inline const T& operator[](size_t index) const { return elements[index]; }
+    inline T& back() { return elements[count - 1]; }
+
+    inline size_t size() const { return count; }
+    inline bool empty() const { return count == 0; }
+    inline T* data() { return elements; }
+    inline const T* data() const { return elements; }
+
+    inline T* begin() { return elements; }
+    inline T* end() { return elements + count; }
+    inline const T* begin() const { return elements; }
+    inline const T* end() const { return elements + count; }
+    inline reverse_iterator rbegin() { return reverse_iterator(end()); }
+    inline reverse_iterator rend() { return reverse_iterator(begin()); }
+    inline const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    inline const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+private:
+    inline bool IsInline() const { return elements == (const T*)storage; }
+
+    // The old elements are not freed when they were in the resource, which for the
+    // arena of an ASTContext would not release them anyway
+    void Grow(uint32_t newCapacity)
+    {
+        T* newElements = (T*)resource->allocate(newCapacity * sizeof(T), alignof(T));
+        memcpy(newElements, elements, count * sizeof(T));
+        elements = newElements;
+        capacity = newCapacity;
+    }
+
+private:
+    std::pmr::memory_resource* resource;
+    T* elements = (T*)storage;
+    uint32_t count = 0;
+    uint32_t capacity = N;
+    alignas(T) unsigned char storage[N * sizeof(T)];
+};
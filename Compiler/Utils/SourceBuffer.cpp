@@ -0,0 +1,179 @@
+#include "SourceBuffer.h"
+
+#include "FastScan.h"
+
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+SourceBuffer::SourceBuffer(SourceBuffer&& other) noexcept
+    : text(std::exchange(other.text, {})), lineStarts(std::move(other.lineStarts)), ownedText(std::move(other.ownedText)),
+      mapping(std::exchange(other.mapping, nullptr)), mappingSize(std::exchange(other.mappingSize, 0))
+#ifdef _WIN32
+      , mappingHandle(std::exchange(other.mappingHandle, nullptr))
+#endif
+{
+}
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        text = std::exchange(other.text, {});
+        lineStarts = std::move(other.lineStarts);
+        ownedText = std::move(other.ownedText);
+        mapping = std::exchange(other.mapping, nullptr);
+        mappingSize = std::exchange(other.mappingSize, 0);
+#ifdef _WIN32
+        mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+SourceBuffer::~SourceBuffer()
+{
+    Release();
+}
+
+SourceBuffer SourceBuffer::FromFile(const std::string& path)
+{
+    SourceBuffer buffer;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw OpenFailedException(path);
+
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        throw OpenFailedException(path);
+    }
+
+    // Empty files cannot be mapped
+    if (fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return buffer;
+    }
+
+    HANDLE mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    // The mapping keeps the file open
+    CloseHandle(file);
+    if (!mappingHandle)
+        throw OpenFailedException(path);
+
+    void* mapping = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (!mapping)
+    {
+        CloseHandle(mappingHandle);
+        throw OpenFailedException(path);
+    }
+
+    buffer.mappingHandle = mappingHandle;
+    buffer.mapping = mapping;
+    buffer.mappingSize = (size_t)fileSize.QuadPart;
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file == -1)
+        throw OpenFailedException(path);
+
+    struct stat fileStat {};
+    if (fstat(file, &fileStat) == -1)
+    {
+        close(file);
+        throw OpenFailedException(path);
+    }
+
+    // Empty files cannot be mapped
+    if (fileStat.st_size == 0)
+    {
+        close(file);
+        return buffer;
+    }
+
+    void* mapping = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // The mapping keeps the file open
+    close(file);
+    if (mapping == MAP_FAILED)
+        throw OpenFailedException(path);
+
+    // The whole file is read front to back by the lexer
+    madvise(mapping, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+
+    buffer.mapping = mapping;
+    buffer.mappingSize = (size_t)fileStat.st_size;
+#endif
+
+    buffer.text = std::string_view((const char*)buffer.mapping, buffer.mappingSize);
+    return buffer;
+}
+
+SourceBuffer SourceBuffer::FromStdin()
+{
+    SourceBuffer buffer;
+    buffer.ownedText = CreateScope<std::string>(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    buffer.text = *buffer.ownedText;
+    return buffer;
+}
+
+SourceBuffer::Location SourceBuffer::GetLocation(size_t index) const
+{
+    if (lineStarts.empty())
+        IndexLines();
+
+    index = std::min(index, text.size());
+    // The last line starting at or before the index
+    auto lineStart = std::upper_bound(lineStarts.begin(), lineStarts.end(), (uint32_t)index) - 1;
+
+    int line = (int)(lineStart - lineStarts.begin()) + 1;
+    int column = (int)(index - *lineStart) + 1;
+    return { line, column };
+}
+
+void SourceBuffer::IndexLines() const
+{
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+
+    lineStarts.push_back(0);
+    for (const char* newLine = FastScan::FindByte(begin, end, '\n'); newLine != end; newLine = FastScan::FindByte(newLine + 1, end, '\n'))
+    {
+        lineStarts.push_back((uint32_t)(newLine + 1 - begin));
+    }
+}
+
+void SourceBuffer::Release()
+{
+    if (mapping)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(mapping);
+        CloseHandle(mappingHandle);
+        mappingHandle = nullptr;
+#else
+        munmap(mapping, mappingSize);
+#endif
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+
+    ownedText = nullptr;
+    text = {};
+    lineStarts.clear();
+}
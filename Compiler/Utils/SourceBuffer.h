@@ -0,0 +1,85 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <exception>
+#include <vector>
+#include <cstdint>
+
+#include "Utils.h"
+
+// Read-only program text. Files are memory mapped, stdin is read in one go and
+// a string_view can be wrapped without copying it. The text is handed to the
+// lexer and parser as a string_view, so the buffer must outlive them
+class SourceBuffer
+{
+public:
+    class OpenFailedException : public std::exception
+    {
+    public:
+        OpenFailedException(const std::string& path)
+        {
+            std::ostringstream oss;
+            oss << "Could not open \"" << path << "\"";
+            msg = oss.str();
+        }
+    public:
+        const char* what()
+        {
+            return msg.c_str();
+        }
+    public:
+        std::string msg;
+    };
+    // 1-based line and column of a character
+    struct Location
+    {
+        int line;
+        int column;
+    };
+public:
+    SourceBuffer() = default;
+
+    // Does not copy or own the text
+    SourceBuffer(std::string_view text)
+        : text(text)
+    {}
+
+    SourceBuffer(SourceBuffer&& other) noexcept;
+    SourceBuffer& operator=(SourceBuffer&& other) noexcept;
+
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+    ~SourceBuffer();
+
+    // Maps the file read-only
+    static SourceBuffer FromFile(const std::string& path);
+    // Reads all of stdin
+    static SourceBuffer FromStdin();
+
+    inline std::string_view View() const { return text; }
+    inline operator std::string_view() const { return text; }
+
+    inline size_t size() const { return text.size(); }
+
+    // Finds the line and column of the character at the given index by binary searching
+    // the line starts. These are found with one vectorised scan the first time it is called
+    Location GetLocation(size_t index) const;
+private:
+    void IndexLines() const;
+    void Release();
+private:
+    std::string_view text{};
+    // Index of the first character of every line, filled in by IndexLines
+    mutable std::vector<uint32_t> lineStarts{};
+    // Only used when the text was read from stdin. Held by pointer so moving
+    // the buffer does not move the characters
+    Scope<std::string> ownedText = nullptr;
+
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+#ifdef _WIN32
+    void* mappingHandle = nullptr;
+#endif
+};
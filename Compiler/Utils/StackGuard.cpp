@@ -0,0 +1,134 @@
+#include "StackGuard.h"
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// Thread with a WORKER_STACK_SIZE stack that runs one task at a time for the thread that
+// started it. The standard library cannot set a thread's stack size, so it is started
+// with the platform's API
+class StackGuard::Worker
+{
+public:
+    Worker(int hops)
+        : hops(hops)
+    {
+#ifdef _WIN32
+        thread = CreateThread(nullptr, WORKER_STACK_SIZE, Entry, this, STACK_SIZE_PARAM_IS_A_RESERVATION, nullptr);
+        if (!thread)
+            throw TooDeepException();
+#else
+        pthread_attr_t attributes;
+        pthread_attr_init(&attributes);
+        pthread_attr_setstacksize(&attributes, WORKER_STACK_SIZE);
+        int error = pthread_create(&thread, &attributes, Entry, this);
+        pthread_attr_destroy(&attributes);
+        if (error != 0)
+            throw TooDeepException();
+#endif
+    }
+
+    Worker(const Worker&) = delete;
+    Worker& operator=(const Worker&) = delete;
+
+    ~Worker()
+    {
+        {
+            std::lock_guard lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+
+#ifdef _WIN32
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+#else
+        pthread_join(thread, nullptr);
+#endif
+    }
+
+    void Run(void (*newTask)(void*), void* newArg)
+    {
+        std::unique_lock lock(mutex);
+        task = newTask;
+        arg = newArg;
+        wake.notify_all();
+        wake.wait(lock, [&]() { return task == nullptr; });
+    }
+
+private:
+#ifdef _WIN32
+    static DWORD WINAPI Entry(void* worker)
+    {
+        ((Worker*)worker)->Loop();
+        return 0;
+    }
+#else
+    static void* Entry(void* worker)
+    {
+        ((Worker*)worker)->Loop();
+        return nullptr;
+    }
+#endif
+
+    void Loop()
+    {
+        // Guarded calls on the worker may use most of its stack
+        char marker;
+        limit = (uintptr_t)&marker - WORKER_STACK_BUDGET;
+        StackGuard::hops = hops;
+
+        std::unique_lock lock(mutex);
+        while (true)
+        {
+            wake.wait(lock, [&]() { return task != nullptr || quit; });
+            if (!task)
+                return;
+
+            // Tasks catch their own exceptions
+            lock.unlock();
+            task(arg);
+            lock.lock();
+
+            task = nullptr;
+            wake.notify_all();
+        }
+    }
+
+private:
+    const int hops;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    void (*task)(void*) = nullptr;
+    void* arg = nullptr;
+    bool quit = false;
+
+#ifdef _WIN32
+    HANDLE thread = nullptr;
+#else
+    pthread_t thread;
+#endif
+};
+
+thread_local std::unique_ptr<StackGuard::Worker> StackGuard::worker;
+
+void StackGuard::Hop(void (*task)(void*), void* arg)
+{
+    if (!worker)
+    {
+        if (hops >= MAX_HOPS)
+            throw TooDeepException();
+        worker = std::make_unique<Worker>(hops + 1);
+    }
+
+    worker->Run(task, arg);
+}
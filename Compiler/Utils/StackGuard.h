@@ -0,0 +1,117 @@
+#pragma once
+#include <optional>
+#include <memory>
+#include <exception>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+
+// Keeps deeply recursive code from overflowing the thread's stack. Recursive functions
+// run their body through Call, which checks how much stack the recursion has used.
+// Past the budget of the thread, the call carries on in a worker thread with a large
+// stack while the current one waits for it. Each thread keeps its worker for the next
+// guarded call that needs it, so a program nested past the budget many times still
+// uses a short chain of threads. The chain is at most MAX_HOPS long
+class StackGuard
+{
+public:
+    // Thrown when the chain of workers is full or a worker could not be started
+    class TooDeepException : public std::exception
+    {
+    public:
+        const char* what() const noexcept override
+        {
+            return "Program is nested too deeply to compile";
+        }
+    };
+public:
+    template<typename F>
+    static inline auto Call(F&& f) -> decltype(f())
+    {
+        // Nested calls within the budget only cost a comparison
+        char marker;
+        if ((uintptr_t)&marker > limit)
+            return f();
+
+        return CallOutside(f);
+    }
+
+    // Stack reserved for each worker, only used memory is committed
+    static constexpr size_t WORKER_STACK_SIZE = 256 * 1024 * 1024;
+    static constexpr int MAX_HOPS = 8;
+
+private:
+    // Small enough to fit the 1MB default stack of Windows threads with room to spare
+    static constexpr size_t STACK_BUDGET = 256 * 1024;
+    // Leaves room for the calls between two guarded ones
+    static constexpr size_t WORKER_STACK_BUDGET = WORKER_STACK_SIZE - 1024 * 1024;
+    // Limit of a thread that is not running a guarded call
+    static constexpr uintptr_t NO_LIMIT = UINTPTR_MAX;
+
+    // Runs the outermost guarded call of a thread, or one that is past the budget
+    template<typename F>
+    static auto CallOutside(F& f) -> decltype(f())
+    {
+        if (limit == NO_LIMIT)
+        {
+            char marker;
+            Outermost outermost(&marker);
+            return f();
+        }
+
+        using Result = decltype(f());
+        std::exception_ptr exception = nullptr;
+        if constexpr (std::is_void_v<Result>)
+        {
+            auto task = [&]() { Rethrowable(exception, f); };
+            Hop([](void* arg) { (*(decltype(task)*)arg)(); }, &task);
+            if (exception)
+                std::rethrow_exception(exception);
+        }
+        else
+        {
+            std::optional<Result> result;
+            auto task = [&]() { Rethrowable(exception, [&]() { result.emplace(f()); }); };
+            Hop([](void* arg) { (*(decltype(task)*)arg)(); }, &task);
+            if (exception)
+                std::rethrow_exception(exception);
+            return std::move(*result);
+        }
+    }
+
+    // Runs the task on the thread's worker, starting it first if needed, and waits for it
+    static void Hop(void (*task)(void*), void* arg);
+
+    // Measures the thread's stack from the outermost guarded call for as long as it runs.
+    // The stack grows down on every platform the compiler targets
+    class Outermost
+    {
+    public:
+        Outermost(const char* marker) { limit = (uintptr_t)marker - STACK_BUDGET; }
+        ~Outermost() { limit = NO_LIMIT; }
+    };
+
+    template<typename F>
+    static void Rethrowable(std::exception_ptr& exception, F&& f)
+    {
+        try
+        {
+            f();
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+    }
+
+    class Worker;
+
+private:
+    // Lowest address the thread's guarded calls may reach without hopping
+    static inline thread_local uintptr_t limit = NO_LIMIT;
+    // Workers between the thread and the one that started the chain
+    static inline thread_local int hops = 0;
+    // Worker of the thread, joined when the thread exits. A worker's own worker is
+    // destroyed as the worker's thread exits, so the whole chain is joined
+    static thread_local std::unique_ptr<Worker> worker;
+};
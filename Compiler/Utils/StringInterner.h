@@ -0,0 +1,151 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+// Dense ID of an interned string
+using SymbolID = uint32_t;
+
+// Maps each distinct string to a SymbolID handed out in order from 0, so names
+// can be compared and hashed as integers. The text is copied into blocks that
+// never move, so the views returned stay valid for the lifetime of the interner.
+// The global interner is shared by every compilation in the process, so interning
+// and lookups may come from several threads. Strings already interned are found
+// under a shared lock, and only new ones take the lock exclusively
+class StringInterner
+{
+public:
+    StringInterner() = default;
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+
+    SymbolID Intern(std::string_view str)
+    {
+        uint32_t hash = Hash(str);
+        {
+            std::shared_lock lock(mutex);
+            SymbolID id = slots[Probe(str, hash)].id;
+            if (id != EMPTY_SLOT)
+                return id;
+        }
+
+        std::unique_lock lock(mutex);
+        // Another thread may have added the string since the lookup
+        size_t slot = Probe(str, hash);
+        if (slots[slot].id != EMPTY_SLOT)
+            return slots[slot].id;
+
+        SymbolID id = (SymbolID)strings.size();
+        strings.push_back(Store(str));
+        slots[slot] = { hash, id };
+
+        // Keeps the table at most half full
+        if (strings.size() * 2 > slots.size())
+            Grow();
+
+        return id;
+    }
+
+    inline std::string_view operator[](SymbolID id) const
+    {
+        std::shared_lock lock(mutex);
+        return strings[id];
+    }
+
+    inline size_t size() const
+    {
+        std::shared_lock lock(mutex);
+        return strings.size();
+    }
+
+    // Interner shared by the lexer, parser and later stages
+    static StringInterner& Global()
+    {
+        static StringInterner interner;
+        return interner;
+    }
+
+private:
+    struct Slot
+    {
+        uint32_t hash = 0;
+        SymbolID id = EMPTY_SLOT;
+    };
+
+    // Slot that holds the string, or the empty slot it would go in. Open addressing with
+    // linear probing, where strings are only compared when the stored hashes match
+    size_t Probe(std::string_view str, uint32_t hash) const
+    {
+        size_t mask = slots.size() - 1;
+        size_t slot = hash & mask;
+        for (; slots[slot].id != EMPTY_SLOT; slot = (slot + 1) & mask)
+        {
+            if (slots[slot].hash == hash && strings[slots[slot].id] == str)
+                break;
+        }
+        return slot;
+    }
+
+    // FNV-1a
+    static inline uint32_t Hash(std::string_view str)
+    {
+        uint32_t hash = 2166136261u;
+        for (char c : str)
+            hash = (hash ^ (unsigned char)c) * 16777619u;
+        return hash;
+    }
+
+    void Grow()
+    {
+        std::vector<Slot> oldSlots(slots.size() * 2);
+        oldSlots.swap(slots);
+
+        size_t mask = slots.size() - 1;
+        for (const Slot& oldSlot : oldSlots)
+        {
+            if (oldSlot.id == EMPTY_SLOT)
+                continue;
+
+            size_t slot = oldSlot.hash & mask;
+            while (slots[slot].id != EMPTY_SLOT)
+                slot = (slot + 1) & mask;
+            slots[slot] = oldSlot;
+        }
+    }
+
+    std::string_view Store(std::string_view str)
+    {
+        if (str.length() > blockRemaining)
+        {
+            size_t blockSize = std::max(BLOCK_SIZE, str.length());
+            blocks.push_back(std::make_unique<char[]>(blockSize));
+            blockHead = blocks.back().get();
+            blockRemaining = blockSize;
+        }
+
+        char* stored = blockHead;
+        std::memcpy(stored, str.data(), str.length());
+        blockHead += str.length();
+        blockRemaining -= str.length();
+        return std::string_view(stored, str.length());
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 16 * 1024;
+    static constexpr SymbolID EMPTY_SLOT = UINT32_MAX;
+
+    mutable std::shared_mutex mutex;
+
+    // Size is always a power of two
+    std::vector<Slot> slots = std::vector<Slot>(64);
+    std::vector<std::string_view> strings;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* blockHead = nullptr;
+    size_t blockRemaining = 0;
+};
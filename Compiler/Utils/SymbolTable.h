@@ -1,8 +1,10 @@
 #pragma once
 #include <vector>
-#include <unordered_map>
+#include <cstdint>
 #include <string>
+#include <sstream>
 
+#include "StringInterner.h"
 #include "../Lexer/Tokens.h"
 #include "../Parser/ASTNodes.h"
 
@@ -13,10 +15,10 @@ public:
     class IdentifierNotFoundException : public std::exception
     {
     public:
-        IdentifierNotFoundException(const std::string& name)
+        IdentifierNotFoundException(SymbolID name)
         {
             std::ostringstream oss;
-            oss << "The identifier \"" << name << "\" was not found";
+            oss << "The identifier \"" << StringInterner::Global()[name] << "\" was not found";
             msg = oss.str();
         }
     public:
@@ -32,84 +34,169 @@ public:
 
     void PushScope(bool isolate = false)
     {
-        scopes.emplace_back();
+        scopeStarts.push_back((uint32_t)bindings.size());
         if (isolate)
             Isolate();
     }
 
+    // Unlinks the scope's declarations from their shadow chains, newest first, which
+    // brings back the entries they shadowed
     void PopScope()
     {
-        scopes.pop_back();
+        uint32_t start = scopeStarts.back();
+        for (uint32_t i = (uint32_t)bindings.size(); i-- > start;)
+            slots[bindings[i].slot].head = bindings[i].shadowed;
+        bindings.resize(start);
+        scopeStarts.pop_back();
+
         // Undo isolation if isolated scope is popped
-        if (scopes.size() < isolatedLevel)
+        if (size() < isolatedLevel)
             isolatedLevel = -1;
     }
 
-    void AddEntry(const std::string& name, T entry)
+    void AddEntry(SymbolID name, T entry)
     {
-        scopes[scopes.size() - 1][name] = entry;
+        uint32_t slot = FindSlot(name);
+        uint32_t head = slots[slot].head;
+
+        // Declaring a name again in the same scope replaces its entry
+        if (head != NONE && bindings[head].level == size())
+        {
+            bindings[head].entry = std::move(entry);
+            return;
+        }
+
+        slots[slot].head = (uint32_t)bindings.size();
+        bindings.push_back({ std::move(entry), slot, head, size() });
     }
 
     void Isolate()
     {
-        isolatedLevel = scopes.size();
+        isolatedLevel = size();
     }
 
     void IsolateNext()
     {
-        isolatedLevel = scopes.size() + 1;
+        isolatedLevel = size() + 1;
+    }
+
+    bool contains(SymbolID name) const
+    {
+        const Binding* binding = Find(name);
+        if (!binding)
+            return false;
+
+        // Allows functions to be referenced outside of the current scope
+        if (binding->level < isolatedLevel)
+            return binding->entry.IsFunction();
+
+        return true;
     }
 
-    bool contains(const std::string& name) const
+    bool InRootScope() const { return scopeStarts.size() == 1; }
+
+    const int size() const { return (int)scopeStarts.size(); }
+
+    // The entry stays where it is until the next AddEntry or PopScope, so callers that
+    // visit nodes while they use it take a copy
+    const T& operator[](SymbolID name) const
+    {
+        const Binding* binding = Find(name);
+        if (!binding || (binding->level < isolatedLevel && !binding->entry.IsFunction()))
+            throw IdentifierNotFoundException(name);
+
+        return binding->entry;
+    }
+public:
+    int isolatedLevel = -1;
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    // A declaration, linked to the one of the same name that it shadows
+    struct Binding
     {
-        int level = scopes.size();
-        // Checks all scopes for the definition
-        for (auto it = scopes.rbegin(); it != scopes.rend(); ++it, --level)
+        T entry;
+        uint32_t slot;
+        uint32_t shadowed;
+        // Number of scopes when it was declared
+        int level;
+    };
+
+    // Newest declaration of a name. Slots are kept once a name is seen, even when
+    // all its declarations have been popped, so no slot is ever removed
+    struct Slot
+    {
+        SymbolID name = NONE;
+        uint32_t head = NONE;
+    };
+
+    // Fibonacci hashing spreads the dense symbol IDs over the table
+    static inline uint32_t Hash(SymbolID name) { return (uint32_t)((name * 0x9E3779B97F4A7C15ull) >> 32); }
+
+    const Binding* Find(SymbolID name) const
+    {
+        size_t mask = slots.size() - 1;
+        for (size_t slot = Hash(name) & mask; slots[slot].name != NONE; slot = (slot + 1) & mask)
         {
-            if (it->contains(name))
-            {
-                if (level < isolatedLevel)
-                {
-                    auto entry = it->at(name);
-                    // Allows functions to be referenced outside of the current scope
-                    return entry.IsFunction();
-                }
-                return true;
-            }
+            if (slots[slot].name == name)
+                return slots[slot].head != NONE ? &bindings[slots[slot].head] : nullptr;
         }
 
-        return false;
+        return nullptr;
     }
 
-    bool InRootScope() const { return scopes.size() == 1; }
+    // Open addressing with linear probing, adding a slot for the name if it has none
+    uint32_t FindSlot(SymbolID name)
+    {
+        size_t mask = slots.size() - 1;
+        size_t slot = Hash(name) & mask;
+        for (; slots[slot].name != NONE; slot = (slot + 1) & mask)
+        {
+            if (slots[slot].name == name)
+                return (uint32_t)slot;
+        }
+
+        // Keeps the table at most half full
+        if ((usedSlots + 1) * 2 > slots.size())
+        {
+            Grow();
+            return FindSlot(name);
+        }
 
-    const int size() const { return scopes.size(); }
+        slots[slot].name = name;
+        usedSlots++;
+        return (uint32_t)slot;
+    }
 
-    const T& operator[](const std::string& name) const
+    // Bindings refer to their slot, so they are moved along with it
+    void Grow()
     {
-        int level = scopes.size();
+        std::vector<Slot> oldSlots(slots.size() * 2);
+        oldSlots.swap(slots);
 
-        // Checks all scopes for the item
-        for (auto it = scopes.rbegin(); it != scopes.rend(); ++it, --level)
+        size_t mask = slots.size() - 1;
+        std::vector<uint32_t> moved(oldSlots.size());
+        for (size_t i = 0; i < oldSlots.size(); i++)
         {
-            if (it->contains(name))
-            {
-                if (level < isolatedLevel)
-                {
-                    auto& entry = it->at(name);
-                    if (entry.IsFunction())
-                        return entry;
-                    else
-                        throw IdentifierNotFoundException(name);
-                }
-                return it->at(name);
-            }
+            if (oldSlots[i].name == NONE)
+                continue;
+
+            size_t slot = Hash(oldSlots[i].name) & mask;
+            while (slots[slot].name != NONE)
+                slot = (slot + 1) & mask;
+            slots[slot] = oldSlots[i];
+            moved[i] = (uint32_t)slot;
         }
 
-        throw IdentifierNotFoundException(name);
+        for (Binding& binding : bindings)
+            binding.slot = moved[binding.slot];
     }
-public:
-    int isolatedLevel = -1;
+
 private:
-    std::vector<std::unordered_map<std::string, T>> scopes;
-};
\ No newline at end of file
+    // Size is always a power of two
+    std::vector<Slot> slots = std::vector<Slot>(64);
+    size_t usedSlots = 0;
+    // Declarations of all open scopes in order, so each scope's are at the end when it is popped
+    std::vector<Binding> bindings;
+    std::vector<uint32_t> scopeStarts;
+};
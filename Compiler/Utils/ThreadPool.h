@@ -0,0 +1,163 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+
+// Fixed set of worker threads that run submitted tasks in order
+class ThreadPool
+{
+public:
+    ThreadPool(size_t numThreads = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        workers.reserve(numThreads);
+        for (size_t i = 0; i < numThreads; i++)
+            workers.emplace_back([this]() { WorkerLoop(); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    // Queues the task, exceptions it throws are rethrown by the future
+    template<typename F>
+    std::future<std::invoke_result_t<F>> Submit(F&& task)
+    {
+        using Result = std::invoke_result_t<F>;
+
+        auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packagedTask->get_future();
+        Enqueue([packagedTask]() { (*packagedTask)(); });
+
+        return result;
+    }
+
+    // Calls task(i) for every i in [0, count) and waits for all of them. The calling
+    // thread takes indices too and only waits for helpers that have started, so this
+    // can be called from inside a task without deadlocking
+    template<typename F>
+    void ParallelFor(size_t count, F&& task)
+    {
+        struct State
+        {
+            std::atomic<size_t> nextIndex = 0;
+            std::mutex mutex;
+            std::condition_variable finished;
+            size_t running = 0;
+            bool closed = false;
+            std::exception_ptr exception = nullptr;
+        };
+
+        auto state = std::make_shared<State>();
+        auto run = [count, &task](State& state)
+        {
+            try
+            {
+                for (size_t i = state.nextIndex++; i < count; i = state.nextIndex++)
+                    task(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                if (!state.exception)
+                    state.exception = std::current_exception();
+                state.nextIndex = count;
+            }
+        };
+
+        size_t numHelpers = count > 0 ? std::min(workers.size(), count - 1) : 0;
+        for (size_t i = 0; i < numHelpers; i++)
+        {
+            Enqueue([state, run]()
+            {
+                {
+                    // The caller has returned, so run may no longer be used
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    if (state->closed)
+                        return;
+                    state->running++;
+                }
+
+                run(*state);
+
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->running--;
+                }
+                state->finished.notify_all();
+            });
+        }
+
+        run(*state);
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->closed = true;
+        state->finished.wait(lock, [&]() { return state->running == 0; });
+
+        if (state->exception)
+            std::rethrow_exception(state->exception);
+    }
+
+    inline size_t size() const { return workers.size(); }
+
+    // Pool shared by the compiler stages, created on first use
+    static ThreadPool& Global()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+private:
+    void Enqueue(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push(std::move(task));
+        }
+        condition.notify_one();
+    }
+
+    void WorkerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty())
+                    return;
+
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+
+            task();
+        }
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
@@ -1,49 +1,82 @@
 #include <iostream>
-#include <vector>
-#include <fstream>
+#include <string>
+#include <string_view>
 
 #include "Lexer/Lexer.h"
 #include "Parser/Parser.h"
+#include "Parser/ASTCache.h"
+#include "Utils/SourceBuffer.h"
 #include <Semantic Analyzer/SemanticAnalyzerVisitor.h>
 #include <Code Generation/CodeGenVisitor.h>
 
 
-int main()
+int main(int argc, char** argv)
 {
-    Lexer lexer{};
-
-    std::ifstream file;
-    std::string line;
-    file.open("src/demo_draw.parl");
-    std::string fileText;
-    std::string fileTextWithLines;
-    if (file.is_open())
+    // Options come before the path. --lazy parses the body of a function only when a call
+    // reaches it, so functions that are never called are left out of the generated code
+    // and their syntax and semantic errors are not reported. --cache reuses the AST cached
+    // next to the file while it is unchanged
+    bool lazy = false;
+    bool cache = false;
+    for (; argc > 1 && std::string_view(argv[1]).starts_with("--"); argc--, argv++)
     {
-        int lineNo = 1;
-        while (std::getline(file, line))
+        std::string_view option = argv[1];
+        if (option == "--lazy")
+            lazy = true;
+        else if (option == "--cache")
+            cache = true;
+        else
         {
-            fileText += line + "\n";
-            fileTextWithLines += std::to_string(lineNo) + ". " + line + "\n";
-            lineNo++;
+            std::cout << "Unknown option \"" << option << "\"" << std::endl;
+            return 1;
         }
-        file.close();
     }
 
-    //std::cout << fileTextWithLines << std::endl;
+    // Reads the program from the given path, or stdin for "-"
+    std::string path = argc > 1 ? argv[1] : "src/demo_draw.parl";
 
-    Parser parser{ };
-    Scope<ASTProgramNode> programAST;
+    SourceBuffer source;
     try
     {
-        programAST = parser.Parse(fileText);
+        source = path == "-" ? SourceBuffer::FromStdin() : SourceBuffer::FromFile(path);
     }
-    catch (Parser::SyntaxErrorException e)
+    catch (SourceBuffer::OpenFailedException& e)
     {
         std::cout << e.what() << std::endl;
         return 1;
     }
 
-    SemanticAnalyzerVisitor visitor{};
+    Parser parser{ lazy };
+    // Owns every node of the AST
+    ASTContext context;
+    // A lazy parse leaves out the function bodies a cache would hold, so it is not cached
+    bool useCache = cache && !lazy && path != "-";
+    ASTProgramNode* programAST = useCache ? ASTCache::Load(ASTCache::PathFor(path), source, context) : nullptr;
+    if (!programAST)
+    {
+        try
+        {
+            programAST = parser.Parse(source, context);
+        }
+        catch (Parser::SyntaxErrorException e)
+        {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+        catch (const StackGuard::TooDeepException& e)
+        {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+
+        if (useCache)
+            ASTCache::Save(ASTCache::PathFor(path), source, *programAST);
+    }
+#ifdef _DEBUG
+    std::cerr << "Parser rewinds: " << parser.RewindCount() << std::endl;
+#endif
+
+    SemanticAnalyzerVisitor visitor{ source };
     try
     {
         programAST->accept(visitor);
@@ -53,12 +86,28 @@ int main()
         std::cout << e.what() << std::endl;
         return 1;
     }
+    // Lazily parsed function bodies are parsed during the analysis
+    catch (Parser::SyntaxErrorException e)
+    {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    catch (const StackGuard::TooDeepException& e)
+    {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
 
     CodeGenVisitor codeGenVisitor{};
     try
     {
         programAST->accept(codeGenVisitor);
     }
+    catch (const StackGuard::TooDeepException& e)
+    {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
     catch (std::exception e)
     {
         std::cout << e.what() << std::endl;